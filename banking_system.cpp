@@ -4,6 +4,28 @@
 #include <cstring>
 #include <fstream>
 #include <cctype>
+#include <cstdio>
+#include <algorithm>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <vector>
+#include <climits>
+#include <cmath>
+#include <charconv>
+#include <string_view>
+#include <memory>
+#include <queue>
+#include <random>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 
 using namespace std;
 
@@ -20,24 +42,39 @@ const int MAX_ACCOUNTS = 100;
 const int MAX_TRANSACTIONS = 100;
 const int MAX_LOANS = 100;
 
-// Helper function to get current date and time as string
-string getCurrentDateTime() {
-    time_t now = time(0);
+// Helper function to format a time as a local date and time string
+string formatDateTime(time_t when) {
     char buffer[80];
     struct tm timeinfo;
 #ifdef _WIN32
-    localtime_s(&timeinfo, &now);
+    localtime_s(&timeinfo, &when);
 #else
-    localtime_r(&now, &timeinfo);
+    localtime_r(&when, &timeinfo);
 #endif
     strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
     return string(buffer);
 }
 
+// The bank's "now": the wall clock, unless a trace replay has pinned it to the recorded time of the
+// operation it is replaying, so interest, velocity windows and transaction dates come out as they did
+// when the traffic was captured
+atomic<long long> pinnedClock(0);
+
+time_t currentTime() {
+    long long pinned = pinnedClock.load(memory_order_relaxed);
+    return pinned != 0 ? static_cast<time_t>(pinned) : time(nullptr);
+}
+
+// Helper function to get current date and time as string
+string getCurrentDateTime() {
+    return formatDateTime(currentTime());
+}
+
 // Helper function to clear input buffer
 void clearInputBuffer() {
     cin.clear();
-    while (cin.get() != '\n');
+    int c;
+    while ((c = cin.get()) != '\n' && c != EOF);
 }
 
 // Helper function to format double to 2 decimal places
@@ -71,921 +108,7927 @@ string formatString(const string& str, int width, bool leftAlign = true) {
     return result;
 }
 
-// Helper function to validate PIN format
-bool isValidPin(const string& pin) {
-    if (pin.length() != 4) return false;
-    for (char c : pin) {
-        if (!isdigit(c)) return false;
-    }
-    return true;
-}
-
-// Customer class
-class Customer {
+// Money class - a signed amount held as a whole number of cents. Balances, amounts and loan figures
+// add, subtract and compare exactly; rounding happens only where a rate is applied, half away from zero.
+class Money {
 private:
-    string name;
-    string address;
-    string phone;
-    int customerID;
-    string pin; // 4-digit PIN code
-    static int nextCustomerID;
+    long long cents;
+
+    explicit constexpr Money(long long value) : cents(value) {}
 
 public:
-    Customer() : customerID(0), pin("0000") {}
-    Customer(string name, string address, string phone, string pin = "0000")
-        : name(name), address(address), phone(phone), pin(pin) {
-        customerID = nextCustomerID++;
-    }
+    // Longest text format() can produce: sign, 17 digits, point and two decimals
+    static const int MAX_CHARS = 24;
+    static const long long RATE_SCALE = 1000000;
+    static const long long DAYS_PER_YEAR = 365;
+    // Largest amount parse accepts and largest balance the bank lets credits build: $10 billion.
+    // Sums of a few such figures stay far inside 64-bit cents, and accrueDays is exact below it.
+    static const long long MAX_CENTS = 1000000000000LL;
 
-    void inputDetails() {
-        clearInputBuffer();
-        cout << "Enter name: ";
-        getline(cin, name);
-        cout << "Enter address: ";
-        getline(cin, address);
-        cout << "Enter phone number: ";
-        getline(cin, phone);
-        customerID = nextCustomerID++;
-    }
+    constexpr Money() : cents(0) {}
 
-    void setPin(const string& newPin) {
-        pin = newPin;
-    }
+    static constexpr Money fromCents(long long value) { return Money(value); }
 
-    void displayDetails() const {
-        cout << "Customer ID: " << customerID << endl;
-        cout << "Name: " << name << endl;
-        cout << "Address: " << address << endl;
-        cout << "Phone: " << phone << endl;
-    }
+    // For rates and other computed figures; rounds to the nearest cent
+    static Money fromDouble(double value) { return Money(llround(value * 100.0)); }
 
-    string getName() const { return name; }
-    int getCustomerID() const { return customerID; }
-    string getPin() const { return pin; }
+    // Rates such as 0.025 are applied as whole millionths (25000)
+    static long long rateToMicros(double rate) { return llround(rate * RATE_SCALE); }
 
-    static int getNextCustomerID() { return nextCustomerID; }
-    static void setNextCustomerID(int id) { nextCustomerID = id; }
+    long long getCents() const { return cents; }
+    double toDouble() const { return cents / 100.0; }
 
-    void saveToFile(ofstream& outFile) const {
-        outFile << customerID << endl;
-        outFile << name << endl;
-        outFile << address << endl;
-        outFile << phone << endl;
-        outFile << pin << endl;
-    }
-
-    void loadFromFile(ifstream& inFile) {
-        inFile >> customerID;
-        inFile.ignore();
-        getline(inFile, name);
-        getline(inFile, address);
-        getline(inFile, phone);
-        if (!getline(inFile, pin) || pin.empty()) {
-            pin = "0000";
-        }
-    }
-};
+    Money operator+(Money other) const { return Money(cents + other.cents); }
+    Money operator-(Money other) const { return Money(cents - other.cents); }
+    Money operator-() const { return Money(-cents); }
+    Money operator*(long long factor) const { return Money(cents * factor); }
+    Money& operator+=(Money other) { cents += other.cents; return *this; }
+    Money& operator-=(Money other) { cents -= other.cents; return *this; }
 
-int Customer::nextCustomerID = 1000;
+    bool operator==(Money other) const { return cents == other.cents; }
+    bool operator!=(Money other) const { return cents != other.cents; }
+    bool operator<(Money other) const { return cents < other.cents; }
+    bool operator<=(Money other) const { return cents <= other.cents; }
+    bool operator>(Money other) const { return cents > other.cents; }
+    bool operator>=(Money other) const { return cents >= other.cents; }
 
-// Transaction class
-class Transaction {
-private:
-    int transactionID;
-    string dateTime;
-    string type;
-    double amount;
-    int fromAccount;
-    int toAccount;
-    static int nextTransactionID;
+    // Simple interest on this amount at a yearly rate in millionths over a number of days of a
+    // 365-day year. Exact for balances up to about $92 billion.
+    Money accrueDays(long long rateMicros, long long days) const {
+        const long long scale = RATE_SCALE * DAYS_PER_YEAR;
+        long long product = cents * rateMicros;
+        long long rest = product % scale * days;
+        long long half = rest < 0 ? -scale / 2 : scale / 2;
+        return Money(product / scale * days + (rest + half) / scale);
+    }
 
-public:
-    Transaction() : transactionID(0), amount(0.0), fromAccount(0), toAccount(-1) {}
-    Transaction(string type, double amount, int fromAcc, int toAcc = -1)
-        : type(type), amount(amount), fromAccount(fromAcc), toAccount(toAcc) {
-        transactionID = nextTransactionID++;
-        dateTime = getCurrentDateTime();
+    Money dividedBy(long long parts) const {
+        long long half = (cents < 0) != (parts < 0) ? -(llabs(parts) / 2) : llabs(parts) / 2;
+        return Money((cents + half) / parts);
     }
 
-    void display() const {
-        cout << formatString(to_string(transactionID), 5) << " | ";
-        cout << formatString(dateTime, 20) << " | ";
-        cout << formatString(type, 12) << " | ";
-        cout << formatString("$" + formatDouble(amount), 10) << " | ";
-        cout << formatString(to_string(fromAccount), 6);
-        if (toAccount != -1) {
-            cout << " -> " << formatString(to_string(toAccount), 6);
+    // Plain decimals with up to two places parse exactly. Anything else from_chars accepts (more
+    // places, exponents from older save files) is rounded to the nearest cent.
+    static bool parse(string_view text, Money& value) {
+        while (!text.empty() && isspace(static_cast<unsigned char>(text.front()))) {
+            text.remove_prefix(1);
         }
-        else {
-            cout << "        ";
+        while (!text.empty() && isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
         }
-        cout << endl;
+        const char* first = text.data();
+        const char* last = first + text.length();
+        bool negative = first != last && *first == '-';
+        if (first != last && (*first == '-' || *first == '+')) {
+            first++;
+        }
+        long long whole = 0;
+        const char* pos = first;
+        if (pos != last && isdigit(static_cast<unsigned char>(*pos))) {
+            from_chars_result result = from_chars(pos, last, whole);
+            if (result.ec != errc()) {
+                return false;
+            }
+            pos = result.ptr;
+        }
+        bool sawDigits = pos != first;
+        int places = 0;
+        long long fraction = 0;
+        if (pos != last && *pos == '.') {
+            pos++;
+            while (pos != last && places < 3 && isdigit(static_cast<unsigned char>(*pos))) {
+                fraction = fraction * 10 + (*pos - '0');
+                places++;
+                pos++;
+            }
+        }
+        if (pos == last && places <= 2 && (sawDigits || places > 0) && whole <= MAX_CENTS / 100) {
+            long long magnitude = whole * 100 + (places == 1 ? fraction * 10 : fraction);
+            if (magnitude > MAX_CENTS) {
+                return false;
+            }
+            value = Money(negative ? -magnitude : magnitude);
+            return true;
+        }
+        double approximate;
+        first = text.data();
+        if (first != last && *first == '+') {
+            first++;
+        }
+        from_chars_result result = from_chars(first, last, approximate);
+        if (result.ec != errc() || result.ptr != last || !(fabs(approximate) * 100.0 <= MAX_CENTS)) {
+            return false;
+        }
+        value = fromDouble(approximate);
+        return true;
     }
 
-    bool isEmpty() const { return transactionID == 0; }
-
-    static int getNextTransactionID() { return nextTransactionID; }
-    static void setNextTransactionID(int id) { nextTransactionID = id; }
+    // Writes "-1234.56" (always two decimals) and returns the end of the text
+    char* format(char* first) const {
+        unsigned long long magnitude = cents < 0 ? 0ULL - static_cast<unsigned long long>(cents)
+                                                 : static_cast<unsigned long long>(cents);
+        if (cents < 0) {
+            *first++ = '-';
+        }
+        first = to_chars(first, first + MAX_CHARS, magnitude / 100).ptr;
+        *first++ = '.';
+        *first++ = static_cast<char>('0' + magnitude % 100 / 10);
+        *first++ = static_cast<char>('0' + magnitude % 10);
+        return first;
+    }
 
-    void saveToFile(ofstream& outFile) const {
-        outFile << transactionID << endl;
-        outFile << dateTime << endl;
-        outFile << type << endl;
-        outFile << amount << endl;
-        outFile << fromAccount << endl;
-        outFile << toAccount << endl;
-    }
-
-    void loadFromFile(ifstream& inFile) {
-        inFile >> transactionID;
-        inFile.ignore();
-        getline(inFile, dateTime);
-        getline(inFile, type);
-        inFile >> amount;
-        inFile >> fromAccount;
-        inFile >> toAccount;
-        inFile.ignore();
+    string toString() const {
+        char buffer[MAX_CHARS];
+        return string(buffer, format(buffer));
     }
 };
 
-int Transaction::nextTransactionID = 10000;
+ostream& operator<<(ostream& out, Money value) {
+    char buffer[Money::MAX_CHARS];
+    return out.write(buffer, value.format(buffer) - buffer);
+}
 
-// Loan class
-class Loan {
-private:
-    int loanID;
-    int customerID;
-    double principal;
-    double interestRate;
-    int durationMonths;
-    double monthlyPayment;
-    double remainingBalance;
-    static int nextLoanID;
+// Batched money kernels over contiguous arrays of cents. Sums keep four independent lanes, which
+// compilers pack into 64-bit integer SIMD adds even at -O2. Integer results do not depend on the order lanes are combined in, so they match
+// the one-at-a-time Money arithmetic exactly.
+const int MONEY_LANES = 4;
 
-public:
-    Loan() : loanID(0), customerID(0), principal(0.0), interestRate(0.0), durationMonths(0), monthlyPayment(0.0), remainingBalance(0.0) {}
-    Loan(int custID, double princ, double rate, int months)
-        : customerID(custID), principal(princ), interestRate(rate), durationMonths(months) {
-        loanID = nextLoanID++;
-        double totalInterest = principal * interestRate * (durationMonths / 12.0);
-        remainingBalance = principal + totalInterest;
-        monthlyPayment = remainingBalance / durationMonths;
+long long sumCents(const long long* cents, size_t count) {
+    long long lanes[MONEY_LANES] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for (; i + MONEY_LANES <= count; i += MONEY_LANES) {
+        lanes[0] += cents[i];
+        lanes[1] += cents[i + 1];
+        lanes[2] += cents[i + 2];
+        lanes[3] += cents[i + 3];
     }
-
-    void makePayment(double amount) {
-        if (amount <= 0) {
-            cout << "Invalid payment amount!" << endl;
-            return;
-        }
-        if (amount > remainingBalance) {
-            cout << "Payment exceeds remaining balance. Paying off $" << formatDouble(remainingBalance) << endl;
-            amount = remainingBalance;
-        }
-        remainingBalance -= amount;
-        cout << "Payment of $" << formatDouble(amount) << " applied to loan " << loanID << endl;
-        cout << "Remaining balance: $" << formatDouble(remainingBalance) << endl;
+    long long total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; i++) {
+        total += cents[i];
     }
+    return total;
+}
 
-    void display() const {
-        cout << "\n--- Loan Details ---" << endl;
-        cout << "Loan ID: " << loanID << endl;
-        cout << "Customer ID: " << customerID << endl;
-        cout << "Principal: $" << formatDouble(principal) << endl;
-        cout << "Interest Rate: " << interestRate * 100 << "%" << endl;
-        cout << "Duration: " << durationMonths << " months" << endl;
-        cout << "Monthly Payment: $" << formatDouble(monthlyPayment) << endl;
-        cout << "Remaining Balance: $" << formatDouble(remainingBalance) << endl;
+// interest[i] = balances[i] at ratesMicros[i] a year over days[i], rounded as Money::accrueDays does.
+// The divides by the rate scale have no packed 64-bit form below AVX-512, so this one stays a
+// branch-free scalar loop.
+void computeInterest(const long long* balances, const long long* ratesMicros, const long long* days,
+                     long long* interest, size_t count) {
+    const long long scale = Money::RATE_SCALE * Money::DAYS_PER_YEAR;
+    for (size_t i = 0; i < count; i++) {
+        long long product = balances[i] * ratesMicros[i];
+        long long rest = product % scale * days[i];
+        long long half = rest < 0 ? -scale / 2 : scale / 2;
+        interest[i] = product / scale * days[i] + (rest + half) / scale;
     }
+}
 
-    bool isActive() const { return remainingBalance > 0; }
-    int getCustomerID() const { return customerID; }
-    int getLoanID() const { return loanID; }
-
-    static int getNextLoanID() { return nextLoanID; }
-    static void setNextLoanID(int id) { nextLoanID = id; }
 
-    void saveToFile(ofstream& outFile) const {
-        outFile << loanID << endl;
-        outFile << customerID << endl;
-        outFile << principal << endl;
-        outFile << interestRate << endl;
-        outFile << durationMonths << endl;
-        outFile << monthlyPayment << endl;
-        outFile << remainingBalance << endl;
-    }
-
-    void loadFromFile(ifstream& inFile) {
-        inFile >> loanID;
-        inFile >> customerID;
-        inFile >> principal;
-        inFile >> interestRate;
-        inFile >> durationMonths;
-        inFile >> monthlyPayment;
-        inFile >> remainingBalance;
-        inFile.ignore();
+// One month of amortization for many loans at once. Each loan pays its instalment, or whatever is left
+// in its final month; fullInterest and finalInterest are the interest parts of those two payments,
+// worked out once per loan, so the monthly step is only compares, masks and subtractions. The month's
+// payment, interest, principal and remaining totals are added to sums[0..3] in the same pass, and the
+// number of loans that paid anything is returned. Baseline SSE2 has no 64-bit compare, so default
+// builds run this as a branch-free scalar loop; AVX2 builds vectorize it, given __restrict, since
+// this many possibly-aliased pointers are more than the compiler will version for.
+long long amortizeMonth(long long* __restrict remaining, const long long* __restrict instalment,
+                        const long long* __restrict fullInterest, const long long* __restrict finalInterest,
+                        long long* __restrict payment, long long* __restrict interest, long long* __restrict principal,
+                        long long* __restrict sums, size_t count) {
+    long long paidTotal = 0, interestTotal = 0, remainingTotal = 0, paying = 0;
+    for (size_t i = 0; i < count; i++) {
+        long long owed = remaining[i];
+        long long lastMask = -static_cast<long long>(owed <= instalment[i]);
+        long long owingMask = -static_cast<long long>(owed != 0);
+        long long paid = instalment[i] ^ ((owed ^ instalment[i]) & lastMask);
+        long long interestPart = (fullInterest[i] ^ ((finalInterest[i] ^ fullInterest[i]) & lastMask)) & owingMask;
+        payment[i] = paid;
+        interest[i] = interestPart;
+        principal[i] = paid - interestPart;
+        remaining[i] = owed - paid;
+        paidTotal += paid;
+        interestTotal += interestPart;
+        remainingTotal += owed - paid;
+        paying += owingMask & 1;
     }
-};
-
-int Loan::nextLoanID = 100000;
+    sums[0] += paidTotal;
+    sums[1] += interestTotal;
+    sums[2] += paidTotal - interestTotal;
+    sums[3] += remainingTotal;
+    return paying;
+}
 
-// Abstract Account class
-class Account {
-protected:
-    int accountNumber;
-    double balance;
-    Customer customer;
-    Transaction transactions[MAX_TRANSACTIONS];
-    int transactionCount;
-    string accountType;
-    static int nextAccountNumber;
+// ReportWriter class - renders fixed-width and CSV reports straight into one reusable block buffer.
+// Numbers are formatted with to_chars into stack scratch space, so no field allocates, and the
+// block is handed to the stream only when full or when the writer is flushed or destroyed.
+class ReportWriter {
+private:
+    ostream& out;
+    vector<char> buffer;
+    size_t used;
 
-public:
-    Account(Customer cust, string type)
-        : customer(cust), balance(0.0), accountType(type), transactionCount(0) {
-        accountNumber = nextAccountNumber++;
+    void reserve(size_t length) {
+        if (used + length > buffer.size()) {
+            flush();
+        }
     }
 
-    virtual ~Account() {}
+    void put(const char* data, size_t length) {
+        if (length > buffer.size()) {
+            flush();
+            out.write(data, static_cast<streamsize>(length));
+            return;
+        }
+        reserve(length);
+        memcpy(buffer.data() + used, data, length);
+        used += length;
+    }
 
-    virtual void deposit(double amount) = 0;
-    virtual bool withdraw(double amount) = 0;
-    virtual void display() const = 0;
+    void pad(char fillChar, int count) {
+        while (count > 0) {
+            int chunk = count;
+            if (static_cast<size_t>(chunk) > buffer.size()) {
+                chunk = static_cast<int>(buffer.size());
+            }
+            reserve(chunk);
+            memset(buffer.data() + used, fillChar, chunk);
+            used += chunk;
+            count -= chunk;
+        }
+    }
 
-    void addTransaction(const Transaction& transaction) {
-        if (transactionCount < MAX_TRANSACTIONS) {
-            transactions[transactionCount] = transaction;
-            transactionCount++;
+    // Truncates or pads to width exactly like formatString
+    void fixed(const char* data, size_t length, int width, bool leftAlign) {
+        if (length >= static_cast<size_t>(width)) {
+            put(data, width);
+            return;
         }
-        else {
-            cout << "Transaction history full. Cannot record transaction." << endl;
+        int padding = width - static_cast<int>(length);
+        if (!leftAlign) {
+            pad(' ', padding);
+        }
+        put(data, length);
+        if (leftAlign) {
+            pad(' ', padding);
         }
     }
 
-    void displayTransactions() const {
-        cout << "\n--- Transaction History for Account " << accountNumber << " ---\n" << endl;
-        cout << formatString("ID", 5) << " | ";
-        cout << formatString("Date & Time", 20) << " | ";
-        cout << formatString("Type", 12) << " | ";
-        cout << formatString("Amount", 10) << " | ";
-        cout << formatString("Account(s)", 15) << endl;
-        cout << formatLine(70) << endl;
-
-        for (int i = 0; i < transactionCount; i++) {
-            transactions[i].display();
-        }
-        if (transactionCount == 0) {
-            cout << "No transactions recorded." << endl;
+    static size_t formatMoney(char* scratch, Money value, bool dollarSign) {
+        char* end = scratch;
+        if (dollarSign) {
+            *end++ = '$';
         }
+        return value.format(end) - scratch;
     }
 
-    int getAccountNumber() const { return accountNumber; }
-    double getBalance() const { return balance; }
-    Customer getCustomer() const { return customer; }
-    string getAccountType() const { return accountType; }
+public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
 
-    static int getNextAccountNumber() { return nextAccountNumber; }
-    static void setNextAccountNumber(int number) { nextAccountNumber = number; }
+    explicit ReportWriter(ostream& outStream, size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : out(outStream), buffer(bufferSize > 0 ? bufferSize : 1), used(0) {}
 
-    virtual void saveToFile(ofstream& outFile) const {
-        outFile << accountNumber << endl;
-        outFile << balance << endl;
-        outFile << accountType << endl;
-        outFile << transactionCount << endl;
-        customer.saveToFile(outFile);
-        for (int i = 0; i < transactionCount; i++) {
-            transactions[i].saveToFile(outFile);
-        }
-    }
+    ~ReportWriter() { flush(); }
 
-    virtual void loadFromFile(ifstream& inFile) {
-        inFile >> accountNumber;
-        inFile >> balance;
-        inFile.ignore();
-        getline(inFile, accountType);
-        inFile >> transactionCount;
-        inFile.ignore();
-        customer.loadFromFile(inFile);
-        for (int i = 0; i < transactionCount; i++) {
-            transactions[i].loadFromFile(inFile);
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    void flush() {
+        if (used > 0) {
+            out.write(buffer.data(), static_cast<streamsize>(used));
+            used = 0;
         }
     }
-};
 
-int Account::nextAccountNumber = 100;
+    ReportWriter& text(const char* str) { put(str, strlen(str)); return *this; }
+    ReportWriter& text(const string& str) { put(str.data(), str.length()); return *this; }
+    ReportWriter& character(char c) { reserve(1); buffer[used++] = c; return *this; }
+    ReportWriter& newline() { return character('\n'); }
+    ReportWriter& separator() { put(" | ", 3); return *this; }
+    ReportWriter& line(int width, char fillChar = '-') { pad(fillChar, width); return newline(); }
+    ReportWriter& spaces(int count) { pad(' ', count); return *this; }
 
-// SavingsAccount class
-class SavingsAccount : public Account {
-private:
-    double interestRate;
-    double minimumBalance;
+    ReportWriter& integer(long long value) {
+        char scratch[24];
+        to_chars_result result = to_chars(scratch, scratch + sizeof(scratch), value);
+        put(scratch, result.ptr - scratch);
+        return *this;
+    }
 
-public:
-    SavingsAccount(Customer cust, double initialDeposit = 0.0, double rate = 0.025)
-        : Account(cust, "Savings"), interestRate(rate), minimumBalance(500.0) {
-        if (initialDeposit > 0) {
-            deposit(initialDeposit);
+    // Six decimal places with trailing zeros trimmed, so a rate computed as 0.035 * 100 prints as
+    // 3.5 rather than its round-trip form 3.5000000000000004
+    ReportWriter& number(double value) {
+        char scratch[64];
+        to_chars_result result = to_chars(scratch, scratch + sizeof(scratch), value, chars_format::fixed, 6);
+        if (result.ec != errc()) {
+            result = to_chars(scratch, scratch + sizeof(scratch), value);
+            put(scratch, result.ptr - scratch);
+            return *this;
         }
+        char* end = result.ptr;
+        while (end[-1] == '0') {
+            end--;
+        }
+        if (end[-1] == '.') {
+            end--;
+        }
+        if (end - scratch == 2 && scratch[0] == '-' && scratch[1] == '0') {
+            put("0", 1);
+            return *this;
+        }
+        put(scratch, end - scratch);
+        return *this;
     }
 
-    void deposit(double amount) override {
-        if (amount <= 0) {
-            cout << "Invalid deposit amount!" << endl;
-            return;
-        }
-        balance += amount;
-        Transaction transaction("Deposit", amount, accountNumber);
-        addTransaction(transaction);
-        cout << "Deposit of $" << formatDouble(amount);
-        cout << " to account " << accountNumber << " successful." << endl;
-        cout << "New balance: $" << formatDouble(balance) << endl;
+    ReportWriter& money(Money value, bool dollarSign = true) {
+        char scratch[Money::MAX_CHARS + 1];
+        put(scratch, formatMoney(scratch, value, dollarSign));
+        return *this;
     }
 
-    bool withdraw(double amount) override {
-        if (amount <= 0) {
-            cout << "Invalid withdrawal amount!" << endl;
-            return false;
-        }
-        if (balance - amount < minimumBalance) {
-            cout << "Withdrawal failed! Must maintain minimum balance of $"
-                << formatDouble(minimumBalance) << endl;
-            return false;
-        }
-        balance -= amount;
-        Transaction transaction("Withdrawal", amount, accountNumber);
-        addTransaction(transaction);
-        cout << "Withdrawal of $" << formatDouble(amount);
-        cout << " from account " << accountNumber << " successful." << endl;
-        cout << "New balance: $" << formatDouble(balance) << endl;
-        return true;
+    ReportWriter& column(const char* str, int width, bool leftAlign = true) {
+        fixed(str, strlen(str), width, leftAlign);
+        return *this;
     }
 
-    void applyInterest() {
-        double interest = balance * interestRate;
-        balance += interest;
-        Transaction transaction("Interest", interest, accountNumber);
-        addTransaction(transaction);
-        cout << "Interest applied: $" << formatDouble(interest) << endl;
-        cout << "New balance: $" << formatDouble(balance) << endl;
+    ReportWriter& column(const string& str, int width, bool leftAlign = true) {
+        fixed(str.data(), str.length(), width, leftAlign);
+        return *this;
     }
 
-    void display() const override {
-        cout << "\n--- Savings Account Details ---" << endl;
-        cout << "Account Number: " << accountNumber << endl;
-        cout << "Account Type: Savings" << endl;
-        cout << "Interest Rate: " << interestRate * 100 << "%" << endl;
-        cout << "Minimum Balance: $" << formatDouble(minimumBalance) << endl;
-        cout << "Current Balance: $" << formatDouble(balance) << endl;
-        cout << "\n--- Customer Details ---" << endl;
-        customer.displayDetails();
+    ReportWriter& integerColumn(long long value, int width, bool leftAlign = true) {
+        char scratch[24];
+        to_chars_result result = to_chars(scratch, scratch + sizeof(scratch), value);
+        fixed(scratch, result.ptr - scratch, width, leftAlign);
+        return *this;
     }
 
-    void saveToFile(ofstream& outFile) const override {
-        Account::saveToFile(outFile);
-        outFile << interestRate << endl;
-        outFile << minimumBalance << endl;
+    ReportWriter& moneyColumn(Money value, int width, bool leftAlign = true, bool dollarSign = true) {
+        char scratch[Money::MAX_CHARS + 1];
+        fixed(scratch, formatMoney(scratch, value, dollarSign), width, leftAlign);
+        return *this;
     }
 
-    void loadFromFile(ifstream& inFile) override {
-        Account::loadFromFile(inFile);
-        inFile >> interestRate;
-        inFile >> minimumBalance;
-        inFile.ignore();
+    // CSV field, quoted only when it contains a delimiter, quote or line break
+    ReportWriter& csvField(const string& str) {
+        if (str.find_first_of(",\"\r\n") == string::npos) {
+            return text(str);
+        }
+        character('"');
+        for (char c : str) {
+            if (c == '"') {
+                character('"');
+            }
+            character(c);
+        }
+        return character('"');
     }
 };
 
-// CurrentAccount class
-class CurrentAccount : public Account {
+// WorkerPool class - fixed set of worker threads that batch jobs such as statement runs fan out across
+class WorkerPool {
 private:
-    double overdraftLimit;
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable taskReady;
+    condition_variable allDone;
+    int activeTasks;
+    bool stopping;
 
-public:
-    CurrentAccount(Customer cust, double initialDeposit = 0.0, double limit = 1000.0)
-        : Account(cust, "Current"), overdraftLimit(limit) {
-        if (initialDeposit > 0) {
-            deposit(initialDeposit);
+    void workerLoop() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) {
+                    return;
+                }
+                task = move(tasks.front());
+                tasks.pop();
+                activeTasks++;
+            }
+            task();
+            {
+                lock_guard<mutex> lock(queueMutex);
+                activeTasks--;
+                if (activeTasks == 0 && tasks.empty()) {
+                    allDone.notify_all();
+                }
+            }
         }
     }
 
-    void deposit(double amount) override {
-        if (amount <= 0) {
-            cout << "Invalid deposit amount!" << endl;
-            return;
+public:
+    explicit WorkerPool(int threadCount = 0) : activeTasks(0), stopping(false) {
+        if (threadCount <= 0) {
+            threadCount = static_cast<int>(thread::hardware_concurrency());
+        }
+        if (threadCount <= 0) {
+            threadCount = 1;
+        }
+        for (int i = 0; i < threadCount; i++) {
+            workers.emplace_back(&WorkerPool::workerLoop, this);
         }
-        balance += amount;
-        Transaction transaction("Deposit", amount, accountNumber);
-        addTransaction(transaction);
-        cout << "Deposit of $" << formatDouble(amount);
-        cout << " to account " << accountNumber << " successful." << endl;
-        cout << "New balance: $" << formatDouble(balance) << endl;
     }
 
-    bool withdraw(double amount) override {
-        if (amount <= 0) {
-            cout << "Invalid withdrawal amount!" << endl;
-            return false;
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
         }
-        if (balance - amount < -overdraftLimit) {
-            cout << "Withdrawal failed! Exceeds overdraft limit of $"
-                << formatDouble(overdraftLimit) << endl;
-            return false;
+        taskReady.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
         }
-        balance -= amount;
-        Transaction transaction("Withdrawal", amount, accountNumber);
-        addTransaction(transaction);
-        cout << "Withdrawal of $" << formatDouble(amount);
-        cout << " from account " << accountNumber << " successful." << endl;
-        cout << "New balance: $" << formatDouble(balance) << endl;
-        return true;
     }
 
-    void display() const override {
-        cout << "\n--- Current Account Details ---" << endl;
-        cout << "Account Number: " << accountNumber << endl;
-        cout << "Account Type: Current" << endl;
-        cout << "Overdraft Limit: $" << formatDouble(overdraftLimit) << endl;
-        cout << "Current Balance: $" << formatDouble(balance) << endl;
-        cout << "\n--- Customer Details ---" << endl;
-        customer.displayDetails();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    void submit(function<void()> task) {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            tasks.push(move(task));
+        }
+        taskReady.notify_one();
     }
 
-    void saveToFile(ofstream& outFile) const override {
-        Account::saveToFile(outFile);
-        outFile << overdraftLimit << endl;
+    void wait() {
+        unique_lock<mutex> lock(queueMutex);
+        allDone.wait(lock, [this] { return activeTasks == 0 && tasks.empty(); });
     }
 
-    void loadFromFile(ifstream& inFile) override {
-        Account::loadFromFile(inFile);
-        inFile >> overdraftLimit;
-        inFile.ignore();
+    // Runs body(lane, index) for every index in [0, count). One task per lane claims indices
+    // from a shared counter, so callers can keep per-lane state in a vector of size() entries.
+    void parallelFor(int count, const function<void(int, int)>& body) {
+        atomic<int> nextIndex(0);
+        for (int lane = 0; lane < size(); lane++) {
+            submit([&body, &nextIndex, count, lane] {
+                int index;
+                while ((index = nextIndex.fetch_add(1)) < count) {
+                    body(lane, index);
+                }
+            });
+        }
+        wait();
     }
 };
 
-// Helper functions for input
-int getIntInput() {
-    int value;
-    while (!(cin >> value)) {
-        cin.clear();
-        while (cin.get() != '\n');
-        cout << "Invalid input. Please enter a number: ";
-    }
-    return value;
+// NullBuffer - stream buffer that discards everything written to it
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+    streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+// QuietOutput - silences cout for its lifetime so benchmarks and batch runs skip console output
+class QuietOutput {
+private:
+    NullBuffer sink;
+    streambuf* saved;
+
+public:
+    QuietOutput() { saved = cout.rdbuf(&sink); }
+    ~QuietOutput() { cout.rdbuf(saved); }
+};
+
+// Results are folded into this so the optimizer cannot drop benchmarked work
+volatile double benchmarkSink = 0.0;
+
+double secondsSince(chrono::steady_clock::time_point started) {
+    return chrono::duration<double>(chrono::steady_clock::now() - started).count();
 }
 
-double getDoubleInput() {
-    double value;
-    while (!(cin >> value)) {
-        cin.clear();
-        while (cin.get() != '\n');
-        cout << "Invalid input. Please enter a number: ";
+// MemoryUsage - objects and bytes one subsystem holds. Bytes are estimates: object sizes plus the
+// heap behind their strings and containers, without allocator overhead.
+struct MemoryUsage {
+    string subsystem;
+    long long objects = 0;
+    long long bytes = 0;
+};
+
+// Heap bytes behind a string; short strings fit inside the string object itself
+size_t stringHeapBytes(const string& text) {
+    static const size_t inlineCapacity = string().capacity();
+    return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+}
+
+// Tree containers (map, set) allocate a node per element: the element plus colour and three links
+template <typename Tree>
+size_t treeNodeBytes(const Tree& tree) {
+    return tree.size() * (sizeof(typename Tree::value_type) + 4 * sizeof(void*));
+}
+
+// Hash containers allocate a node per element (the element plus its chain link) and a bucket array
+template <typename Table>
+size_t hashTableBytes(const Table& table) {
+    return table.bucket_count() * sizeof(void*) + table.size() * (sizeof(typename Table::value_type) + sizeof(void*));
+}
+
+// ParseError - where a parse stopped and why
+struct ParseError {
+    long long line = 0;
+    string field;
+    string message;
+};
+
+// InputScanner class - reads input in large blocks and hands out lines as views into the block, so
+// nothing is copied until a caller keeps a string. Integers and amounts are parsed with from_chars.
+// The first failure is kept with its line number and field name; every later read fails fast.
+class InputScanner {
+private:
+    istream& in;
+    vector<char> buffer;
+    size_t start;
+    size_t end;
+    bool exhausted;
+    long long lineNumber;
+    long long bytesConsumed;
+    bool failed;
+    ParseError error;
+
+    // Moves the unread tail to the front and reads the next block behind it
+    bool refill() {
+        if (exhausted) {
+            return false;
+        }
+        if (start > 0) {
+            memmove(buffer.data(), buffer.data() + start, end - start);
+            end -= start;
+            start = 0;
+        }
+        if (end == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        streamsize got = in.rdbuf()->sgetn(buffer.data() + end, static_cast<streamsize>(buffer.size() - end));
+        if (got <= 0) {
+            exhausted = true;
+            return false;
+        }
+        end += static_cast<size_t>(got);
+        return true;
+    }
+
+    static string describe(string_view text) {
+        string shown(text.substr(0, 40));
+        return "\"" + shown + (text.length() > 40 ? "...\"" : "\"");
+    }
+
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+    explicit InputScanner(istream& input, size_t blockSize = DEFAULT_BLOCK_SIZE)
+        : in(input), buffer(blockSize > 0 ? blockSize : 1), start(0), end(0), exhausted(false),
+          lineNumber(0), bytesConsumed(0), failed(false) {}
+
+    static string_view trim(string_view text) {
+        size_t first = 0;
+        while (first < text.length() && isspace(static_cast<unsigned char>(text[first]))) {
+            first++;
+        }
+        size_t last = text.length();
+        while (last > first && isspace(static_cast<unsigned char>(text[last - 1]))) {
+            last--;
+        }
+        return text.substr(first, last - first);
+    }
+
+    static bool parseInt(string_view text, int& value) {
+        text = trim(text);
+        const char* first = text.data();
+        const char* last = first + text.length();
+        if (first != last && *first == '+') {
+            first++;
+        }
+        from_chars_result result = from_chars(first, last, value);
+        return result.ec == errc() && result.ptr == last && first != last;
+    }
+
+    static bool parseLongLong(string_view text, long long& value) {
+        text = trim(text);
+        const char* first = text.data();
+        const char* last = first + text.length();
+        if (first != last && *first == '+') {
+            first++;
+        }
+        from_chars_result result = from_chars(first, last, value);
+        return result.ec == errc() && result.ptr == last && first != last;
+    }
+
+    static bool parseDouble(string_view text, double& value) {
+        text = trim(text);
+        const char* first = text.data();
+        const char* last = first + text.length();
+        if (first != last && *first == '+') {
+            first++;
+        }
+        from_chars_result result = from_chars(first, last, value);
+        return result.ec == errc() && result.ptr == last && first != last;
+    }
+
+    // Splits on runs of whitespace; returns the number of fields found, at most maxFields
+    static int splitFields(string_view line, string_view* fields, int maxFields) {
+        int count = 0;
+        size_t pos = 0;
+        while (pos < line.length() && count < maxFields) {
+            while (pos < line.length() && isspace(static_cast<unsigned char>(line[pos]))) {
+                pos++;
+            }
+            if (pos == line.length()) {
+                break;
+            }
+            size_t first = pos;
+            while (pos < line.length() && !isspace(static_cast<unsigned char>(line[pos]))) {
+                pos++;
+            }
+            fields[count++] = line.substr(first, pos - first);
+        }
+        return count;
+    }
+
+    // The returned view stays valid only until the next read
+    bool nextLine(string_view& line) {
+        if (failed) {
+            return false;
+        }
+        size_t scanned = start;
+        while (true) {
+            const char* base = buffer.data();
+            const void* newline = memchr(base + scanned, '\n', end - scanned);
+            if (newline) {
+                size_t pos = static_cast<const char*>(newline) - base;
+                line = string_view(base + start, pos - start);
+                bytesConsumed += static_cast<long long>(pos + 1 - start);
+                start = pos + 1;
+                break;
+            }
+            size_t pending = end - start;
+            if (!refill()) {
+                if (start == end) {
+                    return false;
+                }
+                line = string_view(buffer.data() + start, end - start);
+                bytesConsumed += static_cast<long long>(end - start);
+                start = end;
+                break;
+            }
+            scanned = start + pending;
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        lineNumber++;
+        return true;
     }
-    return value;
+
+    // Records the first failure; always returns false so callers can write "return in.fail(...)"
+    bool fail(const string& field, const string& message) {
+        if (!failed) {
+            failed = true;
+            error.line = lineNumber;
+            error.field = field;
+            error.message = message;
+        }
+        return false;
+    }
+
+    bool readLine(string& value, const char* field) {
+        string_view line;
+        if (!nextLine(line)) {
+            return failed ? false : fail(field, "unexpected end of input");
+        }
+        value.assign(line.data(), line.length());
+        return true;
+    }
+
+    bool readInt(int& value, const char* field) {
+        string_view line;
+        if (!nextLine(line)) {
+            return failed ? false : fail(field, "unexpected end of input");
+        }
+        return parseInt(line, value) || fail(field, "expected an integer, found " + describe(line));
+    }
+
+    bool readLongLong(long long& value, const char* field) {
+        string_view line;
+        if (!nextLine(line)) {
+            return failed ? false : fail(field, "unexpected end of input");
+        }
+        return parseLongLong(line, value) || fail(field, "expected an integer, found " + describe(line));
+    }
+
+    bool readDouble(double& value, const char* field) {
+        string_view line;
+        if (!nextLine(line)) {
+            return failed ? false : fail(field, "unexpected end of input");
+        }
+        return parseDouble(line, value) || fail(field, "expected a number, found " + describe(line));
+    }
+
+    bool readMoney(Money& value, const char* field) {
+        string_view line;
+        if (!nextLine(line)) {
+            return failed ? false : fail(field, "unexpected end of input");
+        }
+        return Money::parse(line, value) || fail(field, "expected an amount, found " + describe(line));
+    }
+
+    bool ok() const { return !failed; }
+    const ParseError& getError() const { return error; }
+    long long getLineNumber() const { return lineNumber; }
+    long long getBytesConsumed() const { return bytesConsumed; }
+
+    string describeError() const {
+        return "line " + to_string(error.line) + ", field '" + error.field + "': " + error.message;
+    }
+};
+
+// Helper function to lowercase a string for case-insensitive keys
+string toLowerCopy(const string& str) {
+    string result = str;
+    for (char& c : result) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return result;
 }
 
-string getPinInput() {
-    string pin;
-    clearInputBuffer();
-    cout << "Enter 4-digit PIN: ";
-    getline(cin, pin);
-    return pin;
+// Helper function to validate PIN format
+bool isValidPin(const string& pin) {
+    if (pin.length() != 4) return false;
+    for (char c : pin) {
+        if (!isdigit(c)) return false;
+    }
+    return true;
 }
 
-// Bank class
-class Bank {
+// Customer class
+class Customer {
 private:
-    Account* accounts[MAX_ACCOUNTS];
-    Loan* loans[MAX_LOANS];
-    int accountCount;
-    int loanCount;
-    string bankName;
+    string name;
+    string address;
+    string phone;
+    int customerID;
+    string pin; // 4-digit PIN code
+    static int nextCustomerID;
 
 public:
-    Bank(string name = "OOP Banking System") : bankName(name), accountCount(0), loanCount(0) {
-        for (int i = 0; i < MAX_ACCOUNTS; i++) {
-            accounts[i] = nullptr;
+    Customer() : customerID(0), pin("0000") {}
+    Customer(string name, string address, string phone, string pin = "0000")
+        : name(name), address(address), phone(phone), pin(pin) {
+        customerID = nextCustomerID++;
+    }
+
+    void inputDetails() {
+        clearInputBuffer();
+        cout << "Enter name: ";
+        getline(cin, name);
+        cout << "Enter address: ";
+        getline(cin, address);
+        cout << "Enter phone number: ";
+        getline(cin, phone);
+        customerID = nextCustomerID++;
+    }
+
+    void setPin(const string& newPin) {
+        pin = newPin;
+    }
+
+    void displayDetails(ReportWriter& out) const {
+        out.text("Customer ID: ").integer(customerID).newline();
+        out.text("Name: ").text(name).newline();
+        out.text("Address: ").text(address).newline();
+        out.text("Phone: ").text(phone).newline();
+    }
+
+    string getName() const { return name; }
+    string getAddress() const { return address; }
+    string getPhone() const { return phone; }
+    int getCustomerID() const { return customerID; }
+    string getPin() const { return pin; }
+    size_t heapBytes() const {
+        return stringHeapBytes(name) + stringHeapBytes(address) + stringHeapBytes(phone) + stringHeapBytes(pin);
+    }
+
+    static int getNextCustomerID() { return nextCustomerID; }
+    static void setNextCustomerID(int id) { nextCustomerID = id; }
+
+    void saveToFile(ostream& outFile) const {
+        outFile << customerID << '\n';
+        outFile << name << '\n';
+        outFile << address << '\n';
+        outFile << phone << '\n';
+        outFile << pin << '\n';
+    }
+
+    bool loadFromFile(InputScanner& in) {
+        if (!in.readInt(customerID, "customer ID") || !in.readLine(name, "customer name")
+            || !in.readLine(address, "customer address") || !in.readLine(phone, "customer phone")
+            || !in.readLine(pin, "customer PIN")) {
+            return false;
+        }
+        if (pin.empty()) {
+            pin = "0000";
+        }
+        return true;
+    }
+};
+
+int Customer::nextCustomerID = 1000;
+
+// Transaction class
+class Transaction {
+private:
+    int transactionID;
+    string dateTime;
+    string type;
+    Money amount;
+    int fromAccount;
+    int toAccount;
+    static int nextTransactionID;
+
+public:
+    Transaction() : transactionID(0), fromAccount(0), toAccount(-1) {}
+    Transaction(string type, Money amount, int fromAcc, int toAcc = -1)
+        : type(type), amount(amount), fromAccount(fromAcc), toAccount(toAcc) {
+        transactionID = nextTransactionID++;
+        dateTime = getCurrentDateTime();
+    }
+    // An entry recorded earlier, e.g. read back from an archive
+    Transaction(int id, const string& when, const string& type, Money amount, int fromAcc, int toAcc)
+        : transactionID(id), dateTime(when), type(type), amount(amount), fromAccount(fromAcc), toAccount(toAcc) {}
+
+    void display(ReportWriter& out) const {
+        out.integerColumn(transactionID, 5).separator();
+        out.column(dateTime, 20).separator();
+        out.column(type, 12).separator();
+        out.moneyColumn(amount, 10).separator();
+        out.integerColumn(fromAccount, 6);
+        if (toAccount != -1) {
+            out.text(" -> ").integerColumn(toAccount, 6);
+        }
+        else {
+            out.spaces(8);
+        }
+        out.newline();
+    }
+
+    void writeCsv(ReportWriter& out) const {
+        out.integer(transactionID).character(',');
+        out.csvField(dateTime).character(',');
+        out.csvField(type).character(',');
+        out.money(amount, false).character(',');
+        out.integer(fromAccount).character(',');
+        if (toAccount != -1) {
+            out.integer(toAccount);
+        }
+        out.newline();
+    }
+
+    bool isEmpty() const { return transactionID == 0; }
+
+    // Signed change this entry made to the given account's balance. Transfer and Loan Disbursement
+    // entries are memos recorded alongside the Withdrawal/Deposit that actually moved the money.
+    Money balanceEffect(int accountNumber) const {
+        if (accountNumber != fromAccount) {
+            return Money();
+        }
+        if (type == "Deposit" || type == "Interest") {
+            return amount;
+        }
+        if (type == "Withdrawal") {
+            return -amount;
+        }
+        return Money();
+    }
+
+    int getTransactionID() const { return transactionID; }
+    const string& getDateTime() const { return dateTime; }
+    const string& getType() const { return type; }
+    Money getAmount() const { return amount; }
+    int getFromAccount() const { return fromAccount; }
+    int getToAccount() const { return toAccount; }
+    size_t heapBytes() const { return stringHeapBytes(dateTime) + stringHeapBytes(type); }
+
+    static int getNextTransactionID() { return nextTransactionID; }
+    static void setNextTransactionID(int id) { nextTransactionID = id; }
+
+    void saveToFile(ostream& outFile) const {
+        outFile << transactionID << '\n';
+        outFile << dateTime << '\n';
+        outFile << type << '\n';
+        outFile << amount << '\n';
+        outFile << fromAccount << '\n';
+        outFile << toAccount << '\n';
+    }
+
+    bool loadFromFile(InputScanner& in) {
+        return in.readInt(transactionID, "transaction ID") && in.readLine(dateTime, "transaction date")
+            && in.readLine(type, "transaction type") && in.readMoney(amount, "transaction amount")
+            && in.readInt(fromAccount, "transaction from-account") && in.readInt(toAccount, "transaction to-account");
+    }
+};
+
+int Transaction::nextTransactionID = 10000;
+
+// Loan class
+class Loan {
+private:
+    int loanID;
+    int customerID;
+    Money principal;
+    double interestRate;
+    int durationMonths;
+    Money monthlyPayment;
+    Money remainingBalance;
+    static int nextLoanID;
+
+public:
+    Loan() : loanID(0), customerID(0), interestRate(0.0), durationMonths(0) {}
+    Loan(int custID, Money princ, double rate, int months)
+        : customerID(custID), principal(princ), interestRate(rate), durationMonths(months) {
+        loanID = nextLoanID++;
+        remainingBalance = getTotalRepayable();
+        monthlyPayment = remainingBalance.dividedBy(durationMonths);
+    }
+
+    // Principal plus flat interest over the whole term
+    Money getTotalRepayable() const {
+        return principal + Money::fromDouble(principal.toDouble() * interestRate * (durationMonths / 12.0));
+    }
+
+    void makePayment(Money amount) {
+        if (amount <= Money()) {
+            cout << "Invalid payment amount!" << endl;
+            return;
+        }
+        if (amount > remainingBalance) {
+            cout << "Payment exceeds remaining balance. Paying off $" << remainingBalance << endl;
+            amount = remainingBalance;
+        }
+        remainingBalance -= amount;
+        cout << "Payment of $" << amount << " applied to loan " << loanID << endl;
+        cout << "Remaining balance: $" << remainingBalance << endl;
+    }
+
+    void display() const {
+        cout << "\n--- Loan Details ---" << endl;
+        cout << "Loan ID: " << loanID << endl;
+        cout << "Customer ID: " << customerID << endl;
+        cout << "Principal: $" << principal << endl;
+        cout << "Interest Rate: " << interestRate * 100 << "%" << endl;
+        cout << "Duration: " << durationMonths << " months" << endl;
+        cout << "Monthly Payment: $" << monthlyPayment << endl;
+        cout << "Remaining Balance: $" << remainingBalance << endl;
+    }
+
+    bool isActive() const { return remainingBalance > Money(); }
+    Money getRemainingBalance() const { return remainingBalance; }
+    Money getPrincipal() const { return principal; }
+    Money getMonthlyPayment() const { return monthlyPayment; }
+    int getDurationMonths() const { return durationMonths; }
+    int getCustomerID() const { return customerID; }
+    int getLoanID() const { return loanID; }
+
+    static int getNextLoanID() { return nextLoanID; }
+    static void setNextLoanID(int id) { nextLoanID = id; }
+
+    void saveToFile(ostream& outFile) const {
+        outFile << loanID << '\n';
+        outFile << customerID << '\n';
+        outFile << principal << '\n';
+        outFile << interestRate << '\n';
+        outFile << durationMonths << '\n';
+        outFile << monthlyPayment << '\n';
+        outFile << remainingBalance << '\n';
+    }
+
+    bool loadFromFile(InputScanner& in) {
+        return in.readInt(loanID, "loan ID") && in.readInt(customerID, "loan customer ID")
+            && in.readMoney(principal, "loan principal") && in.readDouble(interestRate, "loan interest rate")
+            && in.readInt(durationMonths, "loan duration") && in.readMoney(monthlyPayment, "loan monthly payment")
+            && in.readMoney(remainingBalance, "loan remaining balance");
+    }
+};
+
+int Loan::nextLoanID = 100000;
+
+// PortfolioMonth - one month of projected cash flow across every loan in a projection
+struct PortfolioMonth {
+    int month = 0;
+    int payingLoans = 0;
+    Money payment;
+    Money interest;
+    Money principal;
+    Money outstanding;
+};
+
+// AmortizationEngine class - month-by-month repayment schedules for a whole loan book. Loans are held
+// as columns, one array per figure, and projected a block at a time: a block's columns stay in cache
+// while amortizeMonth steps it through every month, rather than each month streaming the whole book
+// through memory again. Each payment is split between interest and principal in proportion to the
+// loan's total interest and total repayable, matching the flat-rate terms Loan is written on.
+class AmortizationEngine {
+private:
+    static const size_t BLOCK_LOANS = 1024;
+
+    vector<int> loanIDs;
+    vector<long long> remaining, instalment, fullInterest, finalInterest;
+
+    static long long shareOf(long long amount, long long part, long long whole) {
+        return whole == 0 ? 0 : Money::fromCents(amount * part).dividedBy(whole).getCents();
+    }
+
+public:
+    void addLoan(const Loan& loan) {
+        long long owed = loan.getRemainingBalance().getCents();
+        long long monthly = loan.getMonthlyPayment().getCents();
+        if (monthly <= 0) {
+            monthly = owed;
+        }
+        long long total = loan.getTotalRepayable().getCents();
+        long long totalInterest = total - loan.getPrincipal().getCents();
+        long long months = owed > 0 ? (owed + monthly - 1) / monthly : 0;
+        long long finalPayment = owed > 0 ? owed - (months - 1) * monthly : 0;
+        loanIDs.push_back(loan.getLoanID());
+        remaining.push_back(owed);
+        instalment.push_back(monthly);
+        fullInterest.push_back(shareOf(monthly, totalInterest, total));
+        finalInterest.push_back(shareOf(finalPayment, totalInterest, total));
+    }
+
+    size_t size() const { return loanIDs.size(); }
+
+    // Months until the last loan in the book is repaid
+    int monthsToRepay() const {
+        long long longest = 0;
+        for (size_t i = 0; i < remaining.size(); i++) {
+            if (remaining[i] > 0) {
+                longest = max(longest, (remaining[i] + instalment[i] - 1) / instalment[i]);
+            }
+        }
+        return static_cast<int>(longest);
+    }
+
+    // Projects every loan over the given number of months into per-month portfolio totals, leaving the
+    // engine's balances as they were. With a columnar stream, writes a text header and then one row
+    // group per block of loans: the loan ID column (int32), then for each month the payment, interest,
+    // principal and remaining columns (int64 cents), all in host byte order.
+    void project(int months, vector<PortfolioMonth>& totals, ostream* columnar) const {
+        size_t count = loanIDs.size();
+        totals.assign(months, PortfolioMonth());
+        for (int month = 0; month < months; month++) {
+            totals[month].month = month + 1;
+        }
+        if (columnar) {
+            *columnar << "AMORTIZATION 1\n";
+            *columnar << "loans " << count << " months " << months << " block " << BLOCK_LOANS << '\n';
+            *columnar << "columns loan_id:int32 | payment:int64 interest:int64 principal:int64 remaining:int64\n";
+        }
+        vector<long long> owed(BLOCK_LOANS), payment(BLOCK_LOANS), interest(BLOCK_LOANS), principal(BLOCK_LOANS);
+        vector<long long> monthTotals(4 * months), paying(months);
+        for (size_t start = 0; start < count; start += BLOCK_LOANS) {
+            size_t block = min(BLOCK_LOANS, count - start);
+            copy(remaining.begin() + start, remaining.begin() + start + block, owed.begin());
+            if (columnar) {
+                columnar->write(reinterpret_cast<const char*>(&loanIDs[start]), static_cast<streamsize>(block * sizeof(int)));
+            }
+            for (int month = 0; month < months; month++) {
+                paying[month] += amortizeMonth(owed.data(), &instalment[start], &fullInterest[start], &finalInterest[start],
+                    payment.data(), interest.data(), principal.data(), &monthTotals[4 * month], block);
+                if (columnar) {
+                    const long long* columns[] = { payment.data(), interest.data(), principal.data(), owed.data() };
+                    for (const long long* column : columns) {
+                        columnar->write(reinterpret_cast<const char*>(column), static_cast<streamsize>(block * sizeof(long long)));
+                    }
+                }
+            }
+        }
+        for (int month = 0; month < months; month++) {
+            totals[month].payingLoans = static_cast<int>(paying[month]);
+            totals[month].payment = Money::fromCents(monthTotals[4 * month]);
+            totals[month].interest = Money::fromCents(monthTotals[4 * month + 1]);
+            totals[month].principal = Money::fromCents(monthTotals[4 * month + 2]);
+            totals[month].outstanding = Money::fromCents(monthTotals[4 * month + 3]);
+        }
+    }
+
+    static void displaySchedule(ReportWriter& out, const vector<PortfolioMonth>& months, bool showLoans) {
+        out.column("Month", 6).separator();
+        if (showLoans) {
+            out.column("Loans", 8).separator();
+        }
+        out.column("Payment", 14).separator().column("Interest", 14).separator();
+        out.column("Principal", 14).separator().column("Remaining", 16).newline();
+        out.line(showLoans ? 83 : 72);
+        for (const PortfolioMonth& month : months) {
+            out.integerColumn(month.month, 6).separator();
+            if (showLoans) {
+                out.integerColumn(month.payingLoans, 8).separator();
+            }
+            out.moneyColumn(month.payment, 14).separator().moneyColumn(month.interest, 14).separator();
+            out.moneyColumn(month.principal, 14).separator().moneyColumn(month.outstanding, 16).newline();
+        }
+    }
+};
+
+const size_t AmortizationEngine::BLOCK_LOANS;
+
+// SplitBalance class - credits to a hot account held as several cache-line-sized sub-balances. Each
+// thread adds to its own stripe with one relaxed atomic add, so concurrent credits never contend for
+// a lock or a cache line; the stripes are drained into the real balance only when the full amount is
+// needed.
+class SplitBalance {
+private:
+    struct alignas(64) Stripe {
+        atomic<long long> cents{ 0 };
+        atomic<long long> credits{ 0 };
+    };
+
+    unique_ptr<Stripe[]> stripes;
+    int stripeCount;
+
+    // Threads are numbered in the order they first credit anything, so up to stripeCount of them
+    // each get a stripe to themselves
+    static int threadSlot() {
+        static atomic<int> nextSlot(0);
+        thread_local int slot = nextSlot.fetch_add(1, memory_order_relaxed);
+        return slot;
+    }
+
+public:
+    explicit SplitBalance(int count) : stripes(new Stripe[max(count, 1)]), stripeCount(max(count, 1)) {}
+
+    void credit(Money amount) {
+        Stripe& stripe = stripes[threadSlot() % stripeCount];
+        stripe.cents.fetch_add(amount.getCents(), memory_order_relaxed);
+        stripe.credits.fetch_add(1, memory_order_relaxed);
+    }
+
+    // What the stripes hold right now, without taking it; credits landing meanwhile may be missed
+    Money pending() const {
+        long long total = 0;
+        for (int i = 0; i < stripeCount; i++) {
+            total += stripes[i].cents.load(memory_order_relaxed);
+        }
+        return Money::fromCents(total);
+    }
+
+    // Empties every stripe and returns what they held. A credit racing with the drain is either
+    // taken now or left for the next drain, never lost.
+    Money drain(long long& credits) {
+        long long total = 0;
+        credits = 0;
+        for (int i = 0; i < stripeCount; i++) {
+            total += stripes[i].cents.exchange(0, memory_order_acq_rel);
+            credits += stripes[i].credits.exchange(0, memory_order_acq_rel);
+        }
+        return Money::fromCents(total);
+    }
+
+    int getStripeCount() const { return stripeCount; }
+    size_t memoryBytes() const { return sizeof(SplitBalance) + stripeCount * sizeof(Stripe); }
+};
+
+// Abstract Account class
+class Account {
+protected:
+    int accountNumber;
+    Money balance;
+    Customer customer;
+    Transaction transactions[MAX_TRANSACTIONS];
+    int transactionCount;
+    string accountType;
+    static int nextAccountNumber;
+    // Stripes are created the first time the account is made hot and kept until it is destroyed,
+    // so a credit that raced with the account cooling down still lands somewhere a fold will see
+    atomic<SplitBalance*> creditStripes;
+    atomic<bool> hot;
+
+public:
+    Account(Customer cust, string type)
+        : customer(cust), accountType(type), transactionCount(0), creditStripes(nullptr), hot(false) {
+        accountNumber = nextAccountNumber++;
+    }
+
+    virtual ~Account() {
+        delete creditStripes.load();
+    }
+
+    virtual void deposit(Money amount) = 0;
+    virtual bool withdraw(Money amount) = 0;
+    // The largest debit withdraw would accept from the settled balance
+    virtual Money availableToDebit() const = 0;
+    virtual void display() const = 0;
+    // Size of the whole object, inline transaction history included
+    virtual size_t objectBytes() const = 0;
+
+    void addTransaction(const Transaction& transaction) {
+        if (transactionCount < MAX_TRANSACTIONS) {
+            transactions[transactionCount] = transaction;
+            transactionCount++;
+        }
+        else {
+            cout << "Transaction history full. Cannot record transaction." << endl;
+        }
+    }
+
+    static void displayTransactionHeader(ReportWriter& out, int lineWidth = 70) {
+        out.column("ID", 5).separator();
+        out.column("Date & Time", 20).separator();
+        out.column("Type", 12).separator();
+        out.column("Amount", 10).separator();
+        out.column("Account(s)", 15).newline();
+        out.line(lineWidth);
+    }
+
+    void displayTransactions() const {
+        ReportWriter out(cout);
+        out.text("\n--- Transaction History for Account ").integer(accountNumber).text(" ---\n\n");
+        displayTransactionHeader(out);
+        for (int i = 0; i < transactionCount; i++) {
+            transactions[i].display(out);
+        }
+        if (transactionCount == 0) {
+            out.text("No transactions recorded.\n");
+        }
+    }
+
+    int getTransactionCount() const { return transactionCount; }
+    const Transaction& getTransaction(int index) const { return transactions[index]; }
+
+    size_t historyHeapBytes() const {
+        size_t bytes = 0;
+        for (int i = 0; i < transactionCount; i++) {
+            bytes += transactions[i].heapBytes();
+        }
+        return bytes;
+    }
+
+    // Hot accounts take deposits into per-thread stripes; see Bank::foldHotCredits
+    void makeHot(int stripes) {
+        if (!creditStripes.load(memory_order_acquire)) {
+            creditStripes.store(new SplitBalance(stripes), memory_order_release);
+        }
+        hot.store(true, memory_order_release);
+    }
+
+    void makeCold() { hot.store(false, memory_order_release); }
+    bool isHot() const { return hot.load(memory_order_acquire); }
+
+    // Where deposits should go instead of balance, or nullptr for a normal account
+    SplitBalance* hotCredits() const {
+        return hot.load(memory_order_acquire) ? creditStripes.load(memory_order_acquire) : nullptr;
+    }
+
+    SplitBalance* getCreditStripes() const { return creditStripes.load(memory_order_acquire); }
+
+    // False when the credit would take the balance, unfolded hot credits included, past Money::MAX_CENTS
+    bool canCredit(Money amount) const {
+        SplitBalance* stripes = creditStripes.load(memory_order_acquire);
+        Money held = balance + (stripes ? stripes->pending() : Money());
+        return amount <= Money::fromCents(Money::MAX_CENTS) - held;
+    }
+
+    // Books credits drained from the stripes as one Deposit entry
+    virtual void creditFolded(Money total) {
+        balance += total;
+        Transaction transaction("Deposit", total, accountNumber);
+        addTransaction(transaction);
+    }
+
+    int getAccountNumber() const { return accountNumber; }
+    Money getBalance() const { return balance; }
+    Customer getCustomer() const { return customer; }
+    const Customer& getCustomerRef() const { return customer; }
+    string getAccountType() const { return accountType; }
+
+    static int getNextAccountNumber() { return nextAccountNumber; }
+    static void setNextAccountNumber(int number) { nextAccountNumber = number; }
+
+    void saveToFile(ostream& outFile) const {
+        saveState(outFile, balance, transactionCount);
+    }
+
+    // Writes the record as it stood at the given balance and history length. Snapshot writers pass
+    // published values, and history entries below that length are never rewritten, so this is safe
+    // to call from another thread while writers keep appending.
+    virtual void saveState(ostream& outFile, Money balanceAt, int transactionsAt) const {
+        outFile << accountNumber << '\n';
+        outFile << balanceAt << '\n';
+        outFile << accountType << '\n';
+        outFile << transactionsAt << '\n';
+        customer.saveToFile(outFile);
+        for (int i = 0; i < transactionsAt; i++) {
+            transactions[i].saveToFile(outFile);
+        }
+    }
+
+    virtual bool loadFromFile(InputScanner& in) {
+        if (!in.readInt(accountNumber, "account number") || !in.readMoney(balance, "account balance")
+            || !in.readLine(accountType, "account type") || !in.readInt(transactionCount, "transaction count")) {
+            return false;
+        }
+        if (transactionCount < 0 || transactionCount > MAX_TRANSACTIONS) {
+            int count = transactionCount;
+            transactionCount = 0;
+            return in.fail("transaction count", to_string(count) + " is outside 0-" + to_string(MAX_TRANSACTIONS));
+        }
+        if (!customer.loadFromFile(in)) {
+            return false;
+        }
+        for (int i = 0; i < transactionCount; i++) {
+            if (!transactions[i].loadFromFile(in)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+int Account::nextAccountNumber = 100;
+
+// SavingsAccount class - interest is a yearly rate accrued lazily: lastAccrual marks the day the
+// current balance started earning, and whole days since then are worked out only when the balance is
+// about to change, when the account is next used, or when interest is posted.
+class SavingsAccount : public Account {
+private:
+    double interestRate;
+    Money minimumBalance;
+    time_t lastAccrual;
+    Money accruedInterest;
+
+public:
+    static const long long SECONDS_PER_DAY = 86400;
+
+    SavingsAccount(Customer cust, Money initialDeposit = Money(), double rate = 0.025)
+        : Account(cust, "Savings"), interestRate(rate), minimumBalance(Money::fromCents(50000)),
+          lastAccrual(currentTime()) {
+        if (initialDeposit > Money()) {
+            deposit(initialDeposit);
+        }
+    }
+
+    static long long wholeDaysBetween(time_t from, time_t to) {
+        return to > from ? static_cast<long long>(to - from) / SECONDS_PER_DAY : 0;
+    }
+
+    void deposit(Money amount) override {
+        if (amount <= Money()) {
+            cout << "Invalid deposit amount!" << endl;
+            return;
+        }
+        accrueTo(currentTime());
+        balance += amount;
+        Transaction transaction("Deposit", amount, accountNumber);
+        addTransaction(transaction);
+        cout << "Deposit of $" << amount;
+        cout << " to account " << accountNumber << " successful." << endl;
+        cout << "New balance: $" << balance << endl;
+    }
+
+    bool withdraw(Money amount) override {
+        if (amount <= Money()) {
+            cout << "Invalid withdrawal amount!" << endl;
+            return false;
+        }
+        if (balance - amount < minimumBalance) {
+            cout << "Withdrawal failed! Must maintain minimum balance of $"
+                << minimumBalance << endl;
+            return false;
+        }
+        accrueTo(currentTime());
+        balance -= amount;
+        Transaction transaction("Withdrawal", amount, accountNumber);
+        addTransaction(transaction);
+        cout << "Withdrawal of $" << amount;
+        cout << " from account " << accountNumber << " successful." << endl;
+        cout << "New balance: $" << balance << endl;
+        return true;
+    }
+
+    Money availableToDebit() const override { return balance - minimumBalance; }
+
+    long long getInterestRateMicros() const { return Money::rateToMicros(interestRate); }
+    time_t getLastAccrual() const { return lastAccrual; }
+    Money getAccruedInterest() const { return accruedInterest; }
+
+    long long daysUnaccrued(time_t now) const { return wholeDaysBetween(lastAccrual, now); }
+
+    // Adds interest for days already worked out elsewhere, e.g. by the batched computeInterest kernel
+    void addAccrual(Money interest, long long days) {
+        accruedInterest += interest;
+        lastAccrual += static_cast<time_t>(days * SECONDS_PER_DAY);
+    }
+
+    // Brings accrued interest up to the last whole day before now at the current balance
+    void accrueTo(time_t now) {
+        long long days = daysUnaccrued(now);
+        if (days > 0) {
+            addAccrual(balance.accrueDays(getInterestRateMicros(), days), days);
+        }
+    }
+
+    // Balance with interest earned up to now included, whether or not it has been posted
+    Money balanceAsOf(time_t now) const {
+        return balance + accruedInterest + balance.accrueDays(getInterestRateMicros(), daysUnaccrued(now));
+    }
+
+    // Credits everything accrued up to now as one Interest transaction. Returns false when there
+    // was nothing to post.
+    bool postAccruedInterest(time_t now) {
+        accrueTo(now);
+        if (accruedInterest == Money()) {
+            return false;
+        }
+        Money interest = accruedInterest;
+        accruedInterest = Money();
+        balance += interest;
+        Transaction transaction("Interest", interest, accountNumber);
+        addTransaction(transaction);
+        cout << "Interest posted to account " << accountNumber << ": $" << interest << endl;
+        cout << "New balance: $" << balance << endl;
+        return true;
+    }
+
+    void creditFolded(Money total) override {
+        accrueTo(currentTime());
+        Account::creditFolded(total);
+    }
+
+    // Accrual state from the optional section at the end of a save file
+    void restoreAccrual(time_t accruedSince, Money accrued) {
+        lastAccrual = accruedSince;
+        accruedInterest = accrued;
+    }
+
+    size_t objectBytes() const override { return sizeof(SavingsAccount); }
+
+    void display() const override {
+        ReportWriter out(cout);
+        out.text("\n--- Savings Account Details ---\n");
+        out.text("Account Number: ").integer(accountNumber).newline();
+        out.text("Account Type: Savings\n");
+        out.text("Interest Rate: ").number(interestRate * 100).text("% per year\n");
+        out.text("Minimum Balance: ").money(minimumBalance).newline();
+        out.text("Current Balance: ").money(balance).newline();
+        out.text("Interest Accrued Since: ").text(formatDateTime(lastAccrual)).newline();
+        out.text("\n--- Customer Details ---\n");
+        customer.displayDetails(out);
+    }
+
+    void saveState(ostream& outFile, Money balanceAt, int transactionsAt) const override {
+        Account::saveState(outFile, balanceAt, transactionsAt);
+        outFile << interestRate << '\n';
+        outFile << minimumBalance << '\n';
+    }
+
+    bool loadFromFile(InputScanner& in) override {
+        return Account::loadFromFile(in) && in.readDouble(interestRate, "interest rate")
+            && in.readMoney(minimumBalance, "minimum balance");
+    }
+};
+
+// CurrentAccount class
+class CurrentAccount : public Account {
+private:
+    Money overdraftLimit;
+
+public:
+    CurrentAccount(Customer cust, Money initialDeposit = Money(), Money limit = Money::fromCents(100000))
+        : Account(cust, "Current"), overdraftLimit(limit) {
+        if (initialDeposit > Money()) {
+            deposit(initialDeposit);
+        }
+    }
+
+    void deposit(Money amount) override {
+        if (amount <= Money()) {
+            cout << "Invalid deposit amount!" << endl;
+            return;
+        }
+        balance += amount;
+        Transaction transaction("Deposit", amount, accountNumber);
+        addTransaction(transaction);
+        cout << "Deposit of $" << amount;
+        cout << " to account " << accountNumber << " successful." << endl;
+        cout << "New balance: $" << balance << endl;
+    }
+
+    bool withdraw(Money amount) override {
+        if (amount <= Money()) {
+            cout << "Invalid withdrawal amount!" << endl;
+            return false;
+        }
+        if (balance - amount < -overdraftLimit) {
+            cout << "Withdrawal failed! Exceeds overdraft limit of $"
+                << overdraftLimit << endl;
+            return false;
+        }
+        balance -= amount;
+        Transaction transaction("Withdrawal", amount, accountNumber);
+        addTransaction(transaction);
+        cout << "Withdrawal of $" << amount;
+        cout << " from account " << accountNumber << " successful." << endl;
+        cout << "New balance: $" << balance << endl;
+        return true;
+    }
+
+    Money availableToDebit() const override { return balance + overdraftLimit; }
+
+    size_t objectBytes() const override { return sizeof(CurrentAccount); }
+
+    void display() const override {
+        ReportWriter out(cout);
+        out.text("\n--- Current Account Details ---\n");
+        out.text("Account Number: ").integer(accountNumber).newline();
+        out.text("Account Type: Current\n");
+        out.text("Overdraft Limit: ").money(overdraftLimit).newline();
+        out.text("Current Balance: ").money(balance).newline();
+        out.text("\n--- Customer Details ---\n");
+        customer.displayDetails(out);
+    }
+
+    void saveState(ostream& outFile, Money balanceAt, int transactionsAt) const override {
+        Account::saveState(outFile, balanceAt, transactionsAt);
+        outFile << overdraftLimit << '\n';
+    }
+
+    bool loadFromFile(InputScanner& in) override {
+        return Account::loadFromFile(in) && in.readMoney(overdraftLimit, "overdraft limit");
+    }
+};
+
+// IndexCursor - remembers the last key of a page so the next page resumes after it
+struct IndexCursor {
+    bool started = false;
+    bool exhausted = false;
+    Money balance;
+    string nameKey;
+    int accountNumber = 0;
+
+    void reset() {
+        started = false;
+        exhausted = false;
+        balance = Money();
+        nameKey.clear();
+        accountNumber = 0;
+    }
+};
+
+// AccountIndex class - ordered secondary indexes by balance, customer name and account type.
+// Every query costs O(log n + page size); paging resumes from the cursor key, not an offset.
+class AccountIndex {
+private:
+    struct Entry {
+        Money balance;
+        string nameKey;
+        string accountType;
+    };
+
+    map<int, Entry> entries;
+    set<pair<Money, int>> byBalance;
+    set<pair<string, int>> byName;
+    set<tuple<string, Money, int>> byTypeBalance;
+
+    static void remember(IndexCursor& cursor, Money balance, const string& nameKey, int accountNumber) {
+        cursor.started = true;
+        cursor.balance = balance;
+        cursor.nameKey = nameKey;
+        cursor.accountNumber = accountNumber;
+    }
+
+public:
+    void insert(const Account* account) {
+        remove(account->getAccountNumber());
+        Entry entry;
+        entry.balance = account->getBalance();
+        entry.nameKey = toLowerCopy(account->getCustomerRef().getName());
+        entry.accountType = account->getAccountType();
+        int accNum = account->getAccountNumber();
+        byBalance.insert(make_pair(entry.balance, accNum));
+        byName.insert(make_pair(entry.nameKey, accNum));
+        byTypeBalance.insert(make_tuple(entry.accountType, entry.balance, accNum));
+        entries[accNum] = entry;
+    }
+
+    void remove(int accountNumber) {
+        auto found = entries.find(accountNumber);
+        if (found == entries.end()) {
+            return;
+        }
+        const Entry& entry = found->second;
+        byBalance.erase(make_pair(entry.balance, accountNumber));
+        byName.erase(make_pair(entry.nameKey, accountNumber));
+        byTypeBalance.erase(make_tuple(entry.accountType, entry.balance, accountNumber));
+        entries.erase(found);
+    }
+
+    // Re-keys the balance indexes after a deposit, withdrawal, transfer or interest posting
+    void updateBalance(const Account* account) {
+        int accNum = account->getAccountNumber();
+        auto found = entries.find(accNum);
+        if (found == entries.end()) {
+            insert(account);
+            return;
+        }
+        Entry& entry = found->second;
+        Money newBalance = account->getBalance();
+        if (newBalance == entry.balance) {
+            return;
+        }
+        byBalance.erase(make_pair(entry.balance, accNum));
+        byTypeBalance.erase(make_tuple(entry.accountType, entry.balance, accNum));
+        entry.balance = newBalance;
+        byBalance.insert(make_pair(newBalance, accNum));
+        byTypeBalance.insert(make_tuple(entry.accountType, newBalance, accNum));
+    }
+
+    void clear() {
+        entries.clear();
+        byBalance.clear();
+        byName.clear();
+        byTypeBalance.clear();
+    }
+
+    int size() const { return static_cast<int>(entries.size()); }
+
+    // Largest balances first, optionally restricted to one account type
+    vector<int> largestBalances(int pageSize, IndexCursor& cursor, const string& accountType = "") const {
+        vector<int> page;
+        if (cursor.exhausted) {
+            return page;
+        }
+        if (accountType.empty()) {
+            auto it = cursor.started ? byBalance.lower_bound(make_pair(cursor.balance, cursor.accountNumber))
+                                     : byBalance.end();
+            while (it != byBalance.begin() && static_cast<int>(page.size()) < pageSize) {
+                --it;
+                page.push_back(it->second);
+                remember(cursor, it->first, "", it->second);
+            }
+            cursor.exhausted = (it == byBalance.begin());
+        }
+        else {
+            auto first = byTypeBalance.lower_bound(make_tuple(accountType, Money::fromCents(LLONG_MIN), INT_MIN));
+            auto it = cursor.started ? byTypeBalance.lower_bound(make_tuple(accountType, cursor.balance, cursor.accountNumber))
+                                     : byTypeBalance.upper_bound(make_tuple(accountType, Money::fromCents(LLONG_MAX), INT_MAX));
+            while (it != first && static_cast<int>(page.size()) < pageSize) {
+                --it;
+                page.push_back(get<2>(*it));
+                remember(cursor, get<1>(*it), "", get<2>(*it));
+            }
+            cursor.exhausted = (it == first);
+        }
+        return page;
+    }
+
+    // Most negative balances of one account type first, stopping at the first non-overdrawn account
+    vector<int> mostOverdrawn(const string& accountType, int pageSize, IndexCursor& cursor) const {
+        vector<int> page;
+        if (cursor.exhausted) {
+            return page;
+        }
+        auto it = cursor.started ? byTypeBalance.upper_bound(make_tuple(accountType, cursor.balance, cursor.accountNumber))
+                                 : byTypeBalance.lower_bound(make_tuple(accountType, Money::fromCents(LLONG_MIN), INT_MIN));
+        while (it != byTypeBalance.end() && get<0>(*it) == accountType && get<1>(*it) < Money()
+               && static_cast<int>(page.size()) < pageSize) {
+            page.push_back(get<2>(*it));
+            remember(cursor, get<1>(*it), "", get<2>(*it));
+            ++it;
+        }
+        cursor.exhausted = (it == byTypeBalance.end() || get<0>(*it) != accountType || get<1>(*it) >= Money());
+        return page;
+    }
+
+    // Case-insensitive customer name prefix search in name order; an empty prefix lists everyone
+    vector<int> namePrefix(const string& prefix, int pageSize, IndexCursor& cursor) const {
+        vector<int> page;
+        if (cursor.exhausted) {
+            return page;
+        }
+        string key = toLowerCopy(prefix);
+        auto it = cursor.started ? byName.upper_bound(make_pair(cursor.nameKey, cursor.accountNumber))
+                                 : byName.lower_bound(make_pair(key, INT_MIN));
+        while (it != byName.end() && it->first.compare(0, key.length(), key) == 0
+               && static_cast<int>(page.size()) < pageSize) {
+            page.push_back(it->second);
+            remember(cursor, Money(), it->first, it->second);
+            ++it;
+        }
+        cursor.exhausted = (it == byName.end() || it->first.compare(0, key.length(), key) != 0);
+        return page;
+    }
+
+    MemoryUsage memoryUsage() const {
+        MemoryUsage usage{ "Account indexes", static_cast<long long>(entries.size()), 0 };
+        size_t bytes = treeNodeBytes(entries) + treeNodeBytes(byBalance) + treeNodeBytes(byName) + treeNodeBytes(byTypeBalance);
+        for (const auto& entry : entries) {
+            // Name keys and types are held once in the entry and again in byName / byTypeBalance
+            bytes += 2 * (stringHeapBytes(entry.second.nameKey) + stringHeapBytes(entry.second.accountType));
+        }
+        usage.bytes = static_cast<long long>(bytes);
+        return usage;
+    }
+};
+
+// StatementRunStats - summary of one month-end statement run
+struct StatementRunStats {
+    int statements = 0;
+    long long transactions = 0;
+    int threads = 0;
+    double seconds = 0.0;
+
+    double statementsPerSecond() const {
+        return seconds > 0.0 ? statements / seconds : 0.0;
+    }
+};
+
+// StatementJob class - renders per-account month-end statements in parallel, either one file per
+// account or one shard file per worker lane. Nothing is written to the console while it runs.
+class StatementJob {
+private:
+    string bankName;
+    int year;
+    int month;
+    string periodStart;
+    string periodEnd;
+    string outputDir;
+    bool sharded;
+
+    string periodLabel() const {
+        char label[16];
+        snprintf(label, sizeof(label), "%04d-%02d", year, month);
+        return string(label);
+    }
+
+    void renderStatement(ReportWriter& out, const Account* account, long long& transactionsInPeriod) const {
+        Money netInPeriod;
+        Money netAfterPeriod;
+        Money credits;
+        Money debits;
+        Money interest;
+        int accNum = account->getAccountNumber();
+        for (int i = 0; i < account->getTransactionCount(); i++) {
+            const Transaction& transaction = account->getTransaction(i);
+            Money effect = transaction.balanceEffect(accNum);
+            const string& when = transaction.getDateTime();
+            if (when >= periodEnd) {
+                netAfterPeriod += effect;
+            }
+            else if (when >= periodStart) {
+                netInPeriod += effect;
+                if (effect > Money()) {
+                    credits += effect;
+                }
+                else {
+                    debits -= effect;
+                }
+                if (transaction.getType() == "Interest") {
+                    interest += transaction.getAmount();
+                }
+            }
+        }
+        Money closingBalance = account->getBalance() - netAfterPeriod;
+        Money openingBalance = closingBalance - netInPeriod;
+
+        out.text("=== Monthly Statement ").text(periodLabel()).text(" ===\n");
+        out.text("Bank: ").text(bankName).newline();
+        out.text("Account Number: ").integer(accNum).newline();
+        out.text("Account Type: ").text(account->getAccountType()).newline();
+        out.text("Customer: ").text(account->getCustomerRef().getName());
+        out.text(" (ID ").integer(account->getCustomerRef().getCustomerID()).text(")\n");
+        out.text("Period: ").text(periodStart).text(" to ").text(periodEnd).newline();
+        out.text("Opening Balance: ").money(openingBalance).newline().newline();
+        Account::displayTransactionHeader(out);
+        int listed = 0;
+        for (int i = 0; i < account->getTransactionCount(); i++) {
+            const Transaction& transaction = account->getTransaction(i);
+            const string& when = transaction.getDateTime();
+            if (when >= periodStart && when < periodEnd) {
+                transaction.display(out);
+                listed++;
+            }
+        }
+        if (listed == 0) {
+            out.text("No transactions in this period.\n");
+        }
+        out.newline();
+        out.text("Total Credits: ").money(credits).newline();
+        out.text("Total Debits: ").money(debits).newline();
+        out.text("Interest Earned: ").money(interest).newline();
+        out.text("Closing Balance: ").money(closingBalance).newline();
+        out.line(70, '=');
+        transactionsInPeriod += listed;
+    }
+
+public:
+    StatementJob(const string& bankName, int year, int month, const string& outputDir, bool sharded)
+        : bankName(bankName), year(year), month(month), outputDir(outputDir), sharded(sharded) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%04d-%02d-01 00:00:00", year, month);
+        periodStart = buffer;
+        int endYear = month == 12 ? year + 1 : year;
+        int endMonth = month == 12 ? 1 : month + 1;
+        snprintf(buffer, sizeof(buffer), "%04d-%02d-01 00:00:00", endYear, endMonth);
+        periodEnd = buffer;
+    }
+
+    bool run(const vector<const Account*>& accounts, int threadCount, StatementRunStats& stats) const {
+        error_code ec;
+        filesystem::create_directories(outputDir, ec);
+        if (ec) {
+            cerr << "Error creating directory " << outputDir << ": " << ec.message() << endl;
+            return false;
+        }
+        auto started = chrono::steady_clock::now();
+        WorkerPool pool(threadCount);
+        vector<long long> laneTransactions(pool.size(), 0);
+        vector<int> laneStatements(pool.size(), 0);
+        vector<unique_ptr<ofstream>> shardFiles(pool.size());
+        vector<unique_ptr<ReportWriter>> shardWriters(pool.size());
+        atomic<bool> failed(false);
+        string label = periodLabel();
+
+        if (sharded) {
+            for (int lane = 0; lane < pool.size(); lane++) {
+                string path = outputDir + "/statements_" + label + "_shard" + to_string(lane) + ".txt";
+                shardFiles[lane].reset(new ofstream(path, ios::binary));
+                if (!*shardFiles[lane]) {
+                    cerr << "Error opening " << path << " for writing!" << endl;
+                    return false;
+                }
+                shardWriters[lane].reset(new ReportWriter(*shardFiles[lane], 1 << 20));
+            }
+        }
+
+        pool.parallelFor(static_cast<int>(accounts.size()), [&](int lane, int index) {
+            const Account* account = accounts[index];
+            if (sharded) {
+                renderStatement(*shardWriters[lane], account, laneTransactions[lane]);
+                shardWriters[lane]->newline();
+            }
+            else {
+                string path = outputDir + "/statement_" + to_string(account->getAccountNumber()) + "_" + label + ".txt";
+                ofstream outFile(path, ios::binary);
+                if (!outFile) {
+                    failed = true;
+                    return;
+                }
+                ReportWriter out(outFile, 16 * 1024);
+                renderStatement(out, account, laneTransactions[lane]);
+            }
+            laneStatements[lane]++;
+        });
+
+        for (int lane = 0; lane < pool.size(); lane++) {
+            shardWriters[lane].reset();
+            stats.statements += laneStatements[lane];
+            stats.transactions += laneTransactions[lane];
+        }
+        stats.threads = pool.size();
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        if (failed) {
+            cerr << "Some statement files could not be written to " << outputDir << endl;
+        }
+        return !failed;
+    }
+};
+
+// VelocityRule - caps on money leaving an account within a sliding time window (0 = no cap)
+struct VelocityRule {
+    int maxOperations = 0;
+    Money maxAmount;
+    int windowSeconds = 600;
+
+    bool isActive() const { return maxOperations > 0 || maxAmount > Money(); }
+};
+
+// VelocityWindow class - ring of fixed-width time buckets holding one account's recent debits.
+// Each bucket is expired once as time moves past it, so checks are O(1) amortized. The buckets
+// tile the rule's window exactly: up to BUCKETS of them, each a whole number of seconds wide.
+class VelocityWindow {
+public:
+    static const int BUCKETS = 60;
+
+    // Largest bucket count, at most BUCKETS, that divides the window into whole seconds
+    static int bucketsFor(int windowSeconds) {
+        for (int count = windowSeconds < BUCKETS ? windowSeconds : BUCKETS; count > 1; count--) {
+            if (windowSeconds % count == 0) {
+                return count;
+            }
+        }
+        return 1;
+    }
+
+private:
+    int bucketCount;
+    int bucketSeconds;
+    long long newestBucket;
+    int counts[BUCKETS];
+    Money amounts[BUCKETS];
+    int totalCount;
+    Money totalAmount;
+
+    void advance(time_t now) {
+        long long bucket = static_cast<long long>(now) / bucketSeconds;
+        if (bucket <= newestBucket) {
+            return;
+        }
+        long long stale = bucket - newestBucket;
+        if (stale >= bucketCount) {
+            reset();
+        }
+        else {
+            for (long long b = newestBucket + 1; b <= bucket; b++) {
+                int slot = static_cast<int>(b % bucketCount);
+                totalCount -= counts[slot];
+                totalAmount -= amounts[slot];
+                counts[slot] = 0;
+                amounts[slot] = Money();
+            }
+        }
+        newestBucket = bucket;
+    }
+
+    void reset() {
+        for (int i = 0; i < BUCKETS; i++) {
+            counts[i] = 0;
+            amounts[i] = Money();
+        }
+        totalCount = 0;
+        totalAmount = Money();
+    }
+
+public:
+    explicit VelocityWindow(int windowSeconds = 600) : newestBucket(0) {
+        bucketCount = bucketsFor(max(windowSeconds, 1));
+        bucketSeconds = max(windowSeconds, 1) / bucketCount;
+        reset();
+    }
+
+    int windowSeconds() const { return bucketSeconds * bucketCount; }
+
+    // 0 when allowed, otherwise 1 for the operation cap or 2 for the amount cap
+    int check(const VelocityRule& rule, Money amount, time_t now) {
+        advance(now);
+        if (rule.maxOperations > 0 && totalCount + 1 > rule.maxOperations) {
+            return 1;
+        }
+        if (rule.maxAmount > Money() && totalAmount + amount > rule.maxAmount) {
+            return 2;
+        }
+        return 0;
+    }
+
+    void record(Money amount, time_t now) {
+        advance(now);
+        int slot = static_cast<int>(newestBucket % bucketCount);
+        counts[slot]++;
+        amounts[slot] += amount;
+        totalCount++;
+        totalAmount += amount;
+    }
+
+    int recentOperations() const { return totalCount; }
+    Money recentAmount() const { return totalAmount; }
+
+    // Calls visit(bucketStart, count, amount) for each bucket holding debits, oldest first
+    template <typename Visit>
+    void forEachBucket(Visit visit) const {
+        for (long long b = max(0LL, newestBucket - bucketCount + 1); b <= newestBucket; b++) {
+            int slot = static_cast<int>(b % bucketCount);
+            if (counts[slot] > 0) {
+                visit(static_cast<time_t>(b * bucketSeconds), counts[slot], amounts[slot]);
+            }
+        }
+    }
+};
+
+// VelocityEngine class - applies the default or per-account velocity rule to every debit.
+// When no rule is active the check is a single branch.
+class VelocityEngine {
+private:
+    VelocityRule defaultRule;
+    unordered_map<int, VelocityRule> accountRules;
+    unordered_map<int, VelocityWindow> windows;
+    bool anyRuleActive;
+    long long checks;
+    long long rejectedByCount;
+    long long rejectedByAmount;
+
+    void refreshActive() {
+        anyRuleActive = defaultRule.isActive();
+        for (const auto& entry : accountRules) {
+            anyRuleActive = anyRuleActive || entry.second.isActive();
+        }
+    }
+
+    const VelocityRule& ruleFor(int accountNumber) const {
+        if (!accountRules.empty()) {
+            auto found = accountRules.find(accountNumber);
+            if (found != accountRules.end()) {
+                return found->second;
+            }
+        }
+        return defaultRule;
+    }
+
+    VelocityWindow& windowFor(int accountNumber, const VelocityRule& rule) {
+        auto found = windows.find(accountNumber);
+        if (found == windows.end() || found->second.windowSeconds() != rule.windowSeconds) {
+            found = windows.insert_or_assign(accountNumber, VelocityWindow(rule.windowSeconds)).first;
+        }
+        return found->second;
+    }
+
+public:
+    VelocityEngine() : anyRuleActive(false), checks(0), rejectedByCount(0), rejectedByAmount(0) {}
+
+    void setDefaultRule(const VelocityRule& rule) {
+        defaultRule = rule;
+        windows.clear();
+        refreshActive();
+    }
+
+    void setAccountRule(int accountNumber, const VelocityRule& rule) {
+        accountRules[accountNumber] = rule;
+        windows.erase(accountNumber);
+        refreshActive();
+    }
+
+    void clearAccountRule(int accountNumber) {
+        accountRules.erase(accountNumber);
+        windows.erase(accountNumber);
+        refreshActive();
+    }
+
+    void forgetAccount(int accountNumber) {
+        accountRules.erase(accountNumber);
+        windows.erase(accountNumber);
+    }
+
+    const VelocityRule& getDefaultRule() const { return defaultRule; }
+    const unordered_map<int, VelocityRule>& getAccountRules() const { return accountRules; }
+    long long getRejectedCount() const { return rejectedByCount + rejectedByAmount; }
+    bool isActive() const { return anyRuleActive; }
+
+    // Returns false and prints the reason when the debit would break the account's rule
+    bool allowDebit(int accountNumber, Money amount, time_t now) {
+        if (!anyRuleActive) {
+            return true;
+        }
+        const VelocityRule& rule = ruleFor(accountNumber);
+        if (!rule.isActive()) {
+            return true;
+        }
+        checks++;
+        VelocityWindow& window = windowFor(accountNumber, rule);
+        int verdict = window.check(rule, amount, now);
+        if (verdict == 1) {
+            rejectedByCount++;
+            cout << "Operation rejected! Account " << accountNumber << " is limited to "
+                << rule.maxOperations << " debit(s) per " << window.windowSeconds() << " seconds." << endl;
+            return false;
+        }
+        if (verdict == 2) {
+            rejectedByAmount++;
+            cout << "Operation rejected! Account " << accountNumber << " is limited to $"
+                << rule.maxAmount << " out per " << window.windowSeconds() << " seconds." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void recordDebit(int accountNumber, Money amount, time_t now) {
+        if (!anyRuleActive) {
+            return;
+        }
+        const VelocityRule& rule = ruleFor(accountNumber);
+        if (rule.isActive()) {
+            windowFor(accountNumber, rule).record(amount, now);
+        }
+    }
+
+    // Calls visit(accountNumber, bucketStart, count, amount) for every debit still inside a window
+    template <typename Visit>
+    void forEachRecentDebit(Visit visit) const {
+        for (const auto& entry : windows) {
+            entry.second.forEachBucket([&](time_t bucketStart, int count, Money amount) {
+                visit(entry.first, bucketStart, count, amount);
+            });
+        }
+    }
+
+    // Puts debits back into an account's window, e.g. when replaying traffic captured while they
+    // were still counting against its rule
+    void seedDebits(int accountNumber, time_t bucketStart, int count, Money amount) {
+        if (count <= 0) {
+            return;
+        }
+        VelocityWindow& window = windowFor(accountNumber, ruleFor(accountNumber));
+        window.record(amount, bucketStart);
+        for (int i = 1; i < count; i++) {
+            window.record(Money(), bucketStart);
+        }
+    }
+
+    void displayStats() const {
+        cout << "\n--- Velocity Limits ---" << endl;
+        if (defaultRule.isActive()) {
+            cout << "Default Rule: " << defaultRule.maxOperations << " debit(s), $"
+                << defaultRule.maxAmount << " per " << defaultRule.windowSeconds
+                << " seconds (0 = no cap)" << endl;
+        }
+        else {
+            cout << "Default Rule: none" << endl;
+        }
+        cout << "Account Rules: " << accountRules.size() << endl;
+        cout << "Checks Performed: " << checks << endl;
+        cout << "Rejected (operation cap): " << rejectedByCount << endl;
+        cout << "Rejected (amount cap): " << rejectedByAmount << endl;
+    }
+
+    MemoryUsage memoryUsage() const {
+        return MemoryUsage{ "Velocity windows", static_cast<long long>(windows.size() + accountRules.size()),
+            static_cast<long long>(hashTableBytes(windows) + hashTableBytes(accountRules)) };
+    }
+};
+
+// Helper function to parse "YYYY-MM-DD HH:MM:SS" (or just "YYYY-MM-DD") as local time
+bool parseDateTime(const string& text, time_t& result) {
+    struct tm timeinfo = {};
+    int year = 0, month = 0, day = 0, hour = 23, minute = 59, second = 59;
+    int fields = sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second);
+    if (fields != 3 && fields != 6) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23
+        || minute < 0 || minute > 59 || second < 0 || second > 60) {
+        return false;
+    }
+    timeinfo.tm_year = year - 1900;
+    timeinfo.tm_mon = month - 1;
+    timeinfo.tm_mday = day;
+    timeinfo.tm_hour = hour;
+    timeinfo.tm_min = minute;
+    timeinfo.tm_sec = second;
+    timeinfo.tm_isdst = -1;
+    result = mktime(&timeinfo);
+    return result != static_cast<time_t>(-1);
+}
+
+// DateTimeCodec - converts between history date strings and time_t for the archive codec. Local
+// time only changes offset on an hour boundary, so the codec remembers the hour it last converted
+// and handles later times in that hour with arithmetic instead of mktime/localtime calls.
+class DateTimeCodec {
+private:
+    time_t hourStart = 0;
+    time_t hourEnd = 0;
+    string hourPrefix;   // "YYYY-MM-DD HH:"
+
+    static int twoDigits(const char* text) {
+        return isdigit(static_cast<unsigned char>(text[0])) && isdigit(static_cast<unsigned char>(text[1]))
+            ? (text[0] - '0') * 10 + (text[1] - '0') : -1;
+    }
+
+    void enterHour(time_t when) {
+        string full = formatDateTime(when);
+        int intoHour = twoDigits(&full[14]) * 60 + twoDigits(&full[17]);
+        hourStart = when - intoHour;
+        hourEnd = hourStart + 3600;
+        hourPrefix.assign(full, 0, 14);
+    }
+
+public:
+    // "YYYY-MM-DD HH:MM:SS" to time_t; false for anything else, which the archive stores as text
+    bool parse(const string& text, time_t& result) {
+        if (text.size() != 19 || text[13] != ':' || text[16] != ':') {
+            return false;
+        }
+        int minute = twoDigits(&text[14]), second = twoDigits(&text[17]);
+        if (minute < 0 || minute > 59 || second < 0 || second > 59) {
+            return false;
+        }
+        if (hourEnd == 0 || text.compare(0, 14, hourPrefix) != 0) {
+            time_t parsed;
+            if (!parseDateTime(text, parsed)) {
+                return false;
+            }
+            enterHour(parsed);
+            if (text.compare(0, 14, hourPrefix) != 0) {
+                hourEnd = 0;
+                return false;
+            }
+        }
+        result = hourStart + minute * 60 + second;
+        return true;
+    }
+
+    void format(time_t when, string& result) {
+        if (when < hourStart || when >= hourEnd) {
+            enterHour(when);
+        }
+        int intoHour = static_cast<int>(when - hourStart);
+        char tail[5] = { static_cast<char>('0' + intoHour / 600), static_cast<char>('0' + intoHour / 60 % 10), ':',
+            static_cast<char>('0' + intoHour % 60 / 10), static_cast<char>('0' + intoHour % 10) };
+        result.assign(hourPrefix).append(tail, 5);
+    }
+};
+
+// ArchivedTransaction - one history entry as read back from an archive. type points into the
+// reader's dictionary and stays valid until the reader decodes its next block.
+struct ArchivedTransaction {
+    int accountNumber = 0;
+    int transactionID = 0;
+    string dateTime;
+    const string* type = nullptr;
+    Money amount;
+    int fromAccount = 0;
+    int toAccount = -1;
+
+    Transaction toTransaction() const {
+        return Transaction(transactionID, dateTime, *type, amount, fromAccount, toAccount);
+    }
+};
+
+// Transaction history archive: a compact binary alternative to the six text lines per entry in a
+// save file. Layout:
+//   header   "BKHA", varint format version
+//   blocks   varint entry count, varint payload length, FNV-1a 32-bit checksum of the payload (4 bytes,
+//            little-endian), payload; a zero entry count ends the archive
+//   entry    flags byte: bits 0-4 type code (31 = type name follows and joins the dictionary), bit 5
+//            from-account is the owner, bit 6 no to-account, bit 7 date stored as text
+//            then zigzag varint deltas from the previous entry for owner account, ID and time (or the
+//            date text), the amount in cents, and the accounts not implied by the flags
+// Every block starts from zero deltas and the standard type dictionary, so each one decodes on its
+// own and a damaged block is caught by its checksum rather than corrupting what follows.
+namespace HistoryArchive {
+    const char MAGIC[4] = { 'B', 'K', 'H', 'A' };
+    const unsigned FORMAT_VERSION = 1;
+    const int ENTRIES_PER_BLOCK = 4096;
+    const int LITERAL_TYPE = 31;
+    const unsigned char FROM_OWNER = 1 << 5;
+    const unsigned char NO_TO_ACCOUNT = 1 << 6;
+    const unsigned char TEXT_DATE = 1 << 7;
+    const char* const STANDARD_TYPES[] = { "Deposit", "Withdrawal", "Transfer", "Interest", "Loan Disbursement" };
+
+    inline void putVarint(string& out, unsigned long long value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    inline void putSigned(string& out, long long value) {
+        putVarint(out, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+    }
+
+    inline void putText(string& out, const string& text) {
+        putVarint(out, text.size());
+        out.append(text);
+    }
+
+    inline bool getVarint(const unsigned char*& at, const unsigned char* end, unsigned long long& value) {
+        value = 0;
+        for (int shift = 0; at < end && shift < 64; shift += 7) {
+            unsigned char byte = *at++;
+            value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool getSigned(const unsigned char*& at, const unsigned char* end, long long& value) {
+        unsigned long long raw;
+        if (!getVarint(at, end, raw)) {
+            return false;
+        }
+        value = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(raw & 1);
+        return true;
+    }
+
+    inline bool getText(const unsigned char*& at, const unsigned char* end, string& text) {
+        unsigned long long length;
+        if (!getVarint(at, end, length) || length > static_cast<unsigned long long>(end - at)) {
+            return false;
+        }
+        text.assign(reinterpret_cast<const char*>(at), static_cast<size_t>(length));
+        at += length;
+        return true;
+    }
+
+    inline unsigned checksum(const char* data, size_t length) {
+        unsigned hash = 2166136261u;
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+}
+
+// HistoryArchiveWriter class - streams history entries into the archive format, holding at most one
+// block in memory
+class HistoryArchiveWriter {
+private:
+    ostream& out;
+    string payload;
+    string frame;
+    vector<string> dictionary;
+    DateTimeCodec dates;
+    int blockEntries = 0;
+    long long previousAccount = 0, previousID = 0, previousTime = 0;
+    long long entries = 0, blocks = 0, bytes = 0;
+
+    void startBlock() {
+        payload.clear();
+        dictionary.assign(begin(HistoryArchive::STANDARD_TYPES), end(HistoryArchive::STANDARD_TYPES));
+        blockEntries = 0;
+        previousAccount = previousID = previousTime = 0;
+    }
+
+    void flushBlock() {
+        if (blockEntries == 0) {
+            return;
+        }
+        frame.clear();
+        HistoryArchive::putVarint(frame, static_cast<unsigned long long>(blockEntries));
+        HistoryArchive::putVarint(frame, payload.size());
+        unsigned sum = HistoryArchive::checksum(payload.data(), payload.size());
+        for (int i = 0; i < 4; i++) {
+            frame.push_back(static_cast<char>(sum >> (8 * i)));
+        }
+        out.write(frame.data(), static_cast<streamsize>(frame.size()));
+        out.write(payload.data(), static_cast<streamsize>(payload.size()));
+        bytes += static_cast<long long>(frame.size() + payload.size());
+        blocks++;
+        startBlock();
+    }
+
+public:
+    explicit HistoryArchiveWriter(ostream& output) : out(output) {
+        string header(HistoryArchive::MAGIC, 4);
+        HistoryArchive::putVarint(header, HistoryArchive::FORMAT_VERSION);
+        out.write(header.data(), static_cast<streamsize>(header.size()));
+        bytes = static_cast<long long>(header.size());
+        payload.reserve(64 * 1024);
+        startBlock();
+    }
+
+    void add(int accountNumber, const Transaction& transaction) {
+        const string& type = transaction.getType();
+        size_t code = find(dictionary.begin(), dictionary.end(), type) - dictionary.begin();
+        if (code == dictionary.size() && code == HistoryArchive::LITERAL_TYPE) {
+            // A new block starts with only the standard types, leaving room for this one
+            flushBlock();
+            code = find(dictionary.begin(), dictionary.end(), type) - dictionary.begin();
+        }
+        unsigned char flags = 0;
+        size_t flagsAt = payload.size();
+        payload.push_back('\0');
+        if (code < dictionary.size()) {
+            flags |= static_cast<unsigned char>(code);
+        }
+        else {
+            flags |= HistoryArchive::LITERAL_TYPE;
+            HistoryArchive::putText(payload, type);
+            dictionary.push_back(type);
+        }
+        HistoryArchive::putSigned(payload, accountNumber - previousAccount);
+        HistoryArchive::putSigned(payload, transaction.getTransactionID() - previousID);
+        time_t when;
+        if (dates.parse(transaction.getDateTime(), when)) {
+            HistoryArchive::putSigned(payload, static_cast<long long>(when) - previousTime);
+            previousTime = static_cast<long long>(when);
+        }
+        else {
+            flags |= HistoryArchive::TEXT_DATE;
+            HistoryArchive::putText(payload, transaction.getDateTime());
+        }
+        HistoryArchive::putSigned(payload, transaction.getAmount().getCents());
+        if (transaction.getFromAccount() == accountNumber) {
+            flags |= HistoryArchive::FROM_OWNER;
+        }
+        else {
+            HistoryArchive::putSigned(payload, static_cast<long long>(transaction.getFromAccount()) - accountNumber);
+        }
+        if (transaction.getToAccount() == -1) {
+            flags |= HistoryArchive::NO_TO_ACCOUNT;
+        }
+        else {
+            HistoryArchive::putSigned(payload, static_cast<long long>(transaction.getToAccount()) - transaction.getFromAccount());
+        }
+        payload[flagsAt] = static_cast<char>(flags);
+        previousAccount = accountNumber;
+        previousID = transaction.getTransactionID();
+        entries++;
+        if (++blockEntries == HistoryArchive::ENTRIES_PER_BLOCK) {
+            flushBlock();
+        }
+    }
+
+    // Writes the last block and the end marker; false if the stream failed along the way
+    bool finish() {
+        flushBlock();
+        out.put('\0');
+        bytes++;
+        out.flush();
+        return static_cast<bool>(out);
+    }
+
+    long long getEntryCount() const { return entries; }
+    long long getBlockCount() const { return blocks; }
+    long long getByteCount() const { return bytes; }
+};
+
+// HistoryArchiveReader class - decodes an archive a block at a time, checking each block's checksum
+class HistoryArchiveReader {
+private:
+    istream& in;
+    vector<unsigned char> payload;
+    vector<string> dictionary;
+    DateTimeCodec dates;
+    string error;
+    long long blocks = 0;
+    bool finished = false;
+
+    bool readVarint(unsigned long long& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == EOF) {
+                return false;
+            }
+            value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+            if (byte < 0x80) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool fail(const string& message) {
+        error = "block " + to_string(blocks + 1) + ": " + message;
+        finished = true;
+        return false;
+    }
+
+public:
+    explicit HistoryArchiveReader(istream& input) : in(input) {
+        dictionary.reserve(HistoryArchive::LITERAL_TYPE);
+        char magic[4];
+        unsigned long long version = 0;
+        if (!in.read(magic, 4) || memcmp(magic, HistoryArchive::MAGIC, 4) != 0) {
+            error = "not a transaction history archive";
+            finished = true;
+        }
+        else if (!readVarint(version) || version != HistoryArchive::FORMAT_VERSION) {
+            error = "unsupported archive version " + to_string(version);
+            finished = true;
+        }
+    }
+
+    // Decodes the next block into entries, reusing their storage. Returns false at the end of the
+    // archive or on damage; getError() tells the two apart.
+    bool nextBlock(vector<ArchivedTransaction>& entries) {
+        unsigned long long count = 0, length = 0;
+        if (finished) {
+            return false;
+        }
+        if (!readVarint(count)) {
+            return fail("archive is truncated");
+        }
+        if (count == 0) {
+            finished = true;
+            return false;
+        }
+        unsigned char sumBytes[4];
+        if (count > static_cast<unsigned long long>(HistoryArchive::ENTRIES_PER_BLOCK) || !readVarint(length)
+            || length > 64ULL * HistoryArchive::ENTRIES_PER_BLOCK * 16) {
+            return fail("bad block header");
+        }
+        payload.resize(static_cast<size_t>(length));
+        if (!in.read(reinterpret_cast<char*>(sumBytes), 4)
+            || !in.read(reinterpret_cast<char*>(payload.data()), static_cast<streamsize>(length))) {
+            return fail("archive is truncated");
+        }
+        unsigned sum = sumBytes[0] | sumBytes[1] << 8 | sumBytes[2] << 16 | static_cast<unsigned>(sumBytes[3]) << 24;
+        if (HistoryArchive::checksum(reinterpret_cast<const char*>(payload.data()), payload.size()) != sum) {
+            return fail("checksum mismatch");
+        }
+        dictionary.assign(begin(HistoryArchive::STANDARD_TYPES), end(HistoryArchive::STANDARD_TYPES));
+        entries.resize(static_cast<size_t>(count));
+        const unsigned char* at = payload.data();
+        const unsigned char* end = at + payload.size();
+        long long account = 0, id = 0, when = 0, delta = 0, cents = 0;
+        string literalType;
+        for (ArchivedTransaction& entry : entries) {
+            if (at == end) {
+                return fail("block ends early");
+            }
+            unsigned char flags = *at++;
+            int code = flags & HistoryArchive::LITERAL_TYPE;
+            if (code == HistoryArchive::LITERAL_TYPE) {
+                if (!HistoryArchive::getText(at, end, literalType)) {
+                    return fail("bad type name");
+                }
+                size_t known = find(dictionary.begin(), dictionary.end(), literalType) - dictionary.begin();
+                if (known == dictionary.size()) {
+                    if (dictionary.size() == HistoryArchive::LITERAL_TYPE) {
+                        return fail("too many transaction types in one block");
+                    }
+                    dictionary.push_back(literalType);
+                }
+                entry.type = &dictionary[known];
+            }
+            else if (code < static_cast<int>(dictionary.size())) {
+                entry.type = &dictionary[code];
+            }
+            else {
+                return fail("unknown type code " + to_string(code));
+            }
+            if (!HistoryArchive::getSigned(at, end, delta)) {
+                return fail("bad account number");
+            }
+            account += delta;
+            if (!HistoryArchive::getSigned(at, end, delta)) {
+                return fail("bad transaction ID");
+            }
+            id += delta;
+            if (flags & HistoryArchive::TEXT_DATE) {
+                if (!HistoryArchive::getText(at, end, entry.dateTime)) {
+                    return fail("bad date");
+                }
+            }
+            else {
+                if (!HistoryArchive::getSigned(at, end, delta)) {
+                    return fail("bad date");
+                }
+                when += delta;
+                dates.format(static_cast<time_t>(when), entry.dateTime);
+            }
+            if (!HistoryArchive::getSigned(at, end, cents)) {
+                return fail("bad amount");
+            }
+            entry.accountNumber = static_cast<int>(account);
+            entry.transactionID = static_cast<int>(id);
+            entry.amount = Money::fromCents(cents);
+            entry.fromAccount = entry.accountNumber;
+            entry.toAccount = -1;
+            if (!(flags & HistoryArchive::FROM_OWNER)) {
+                if (!HistoryArchive::getSigned(at, end, delta)) {
+                    return fail("bad from-account");
+                }
+                entry.fromAccount = static_cast<int>(account + delta);
+            }
+            if (!(flags & HistoryArchive::NO_TO_ACCOUNT)) {
+                if (!HistoryArchive::getSigned(at, end, delta)) {
+                    return fail("bad to-account");
+                }
+                entry.toAccount = static_cast<int>(entry.fromAccount + delta);
+            }
+        }
+        if (at != end) {
+            return fail("block has trailing bytes");
+        }
+        blocks++;
+        return true;
+    }
+
+    const string& getError() const { return error; }
+    long long getBlockCount() const { return blocks; }
+};
+
+// TraceOp - the operations a traffic trace records: client traffic, the bank's own scheduled work,
+// and the settings that decide their outcome
+enum TraceOp : unsigned char {
+    TRACE_END = 0,
+    TRACE_DEPOSIT = 1,
+    TRACE_WITHDRAWAL = 2,
+    TRACE_TRANSFER = 3,
+    TRACE_LOAN = 4,
+    TRACE_LOAN_PAYMENT = 5,
+    TRACE_MONTH_END_INTEREST = 6,
+    TRACE_OPEN_ACCOUNT = 7,
+    TRACE_CLOSE_ACCOUNT = 8,
+    TRACE_HOT_ON = 9,
+    TRACE_HOT_OFF = 10,
+    TRACE_SCHEDULE = 11,
+    TRACE_CANCEL_ORDER = 12,
+    TRACE_RUN_DUE = 13,
+    TRACE_VELOCITY_RULE = 14,
+    TRACE_VELOCITY_CLEAR = 15,
+    TRACE_VELOCITY_DEBITS = 16,
+    TRACE_POST_ALL_INTEREST = 17
+};
+
+// TraceRecord - one captured operation. atMicros is when it arrived, counted from the start of
+// capture; when is the bank clock's time for it. How the other fields are used depends on the op:
+//   account  account number; the loan ID for loan payments, the order ID for cancels, 0 for the
+//            default velocity rule; for opens, the number the new account was given
+//   other    destination account for transfers and standing orders, term in months for loans,
+//            customer ID for opens, stripe count for hot accounts, debit cap for velocity rules
+//   amount   money moved; the amount cap for velocity rules, the window total for velocity debits
+//   due      first due time for standing orders, bucket time for velocity debits
+//   period   repeat interval for standing orders, window seconds for velocity rules, debit count
+//            for velocity debits
+//   text     account type, name, address, phone and PIN for opens
+struct TraceRecord {
+    TraceOp op = TRACE_END;
+    bool applied = false;
+    long long atMicros = 0;
+    time_t when = 0;
+    int account = 0;
+    int other = 0;
+    Money amount;
+    long long due = 0;
+    long long period = 0;
+    vector<string> text;
+};
+
+// Traffic trace file: "BKTR", varint format version, zigzag varint bank clock when capture started,
+// then one record per captured operation:
+//   op byte (bit 7 set when the bank applied the operation), varint microseconds since the previous
+//   record, zigzag varint seconds of bank clock since the previous record, then the op's fields as
+//   zigzag varints (account, other, amount in cents, due as seconds after the record, period) and
+//   a varint count of length-prefixed strings, each only when the op uses it (see TrafficTrace::fieldsOf)
+// A TRACE_END record (op, gap and clock only) closes the operations, followed by the book as of its
+// clock: a varint count of (account number, balance cents) pairs, interest accrued but not yet posted
+// included, and a varint count of (loan ID, remaining cents) pairs.
+namespace TrafficTrace {
+    const char MAGIC[4] = { 'B', 'K', 'T', 'R' };
+    const unsigned FORMAT_VERSION = 2;
+    const unsigned char APPLIED = 0x80;
+    const TraceOp LAST_OP = TRACE_POST_ALL_INTEREST;
+
+    const unsigned char ACCOUNT = 1, OTHER = 2, AMOUNT = 4, DUE = 8, PERIOD = 16, TEXT = 32;
+
+    inline unsigned char fieldsOf(TraceOp op) {
+        static const unsigned char fields[LAST_OP + 1] = {
+            0,                                      // TRACE_END
+            ACCOUNT | AMOUNT,                       // TRACE_DEPOSIT
+            ACCOUNT | AMOUNT,                       // TRACE_WITHDRAWAL
+            ACCOUNT | OTHER | AMOUNT,               // TRACE_TRANSFER
+            ACCOUNT | OTHER | AMOUNT,               // TRACE_LOAN
+            ACCOUNT | AMOUNT,                       // TRACE_LOAN_PAYMENT
+            0,                                      // TRACE_MONTH_END_INTEREST
+            ACCOUNT | OTHER | AMOUNT | TEXT,        // TRACE_OPEN_ACCOUNT
+            ACCOUNT,                                // TRACE_CLOSE_ACCOUNT
+            ACCOUNT | OTHER,                        // TRACE_HOT_ON
+            ACCOUNT,                                // TRACE_HOT_OFF
+            ACCOUNT | OTHER | AMOUNT | DUE | PERIOD, // TRACE_SCHEDULE
+            ACCOUNT,                                // TRACE_CANCEL_ORDER
+            0,                                      // TRACE_RUN_DUE
+            ACCOUNT | OTHER | AMOUNT | PERIOD,      // TRACE_VELOCITY_RULE
+            ACCOUNT,                                // TRACE_VELOCITY_CLEAR
+            ACCOUNT | AMOUNT | DUE | PERIOD,        // TRACE_VELOCITY_DEBITS
+            0                                       // TRACE_POST_ALL_INTEREST
+        };
+        return op <= LAST_OP ? fields[op] : 0;
+    }
+}
+
+// TraceRecorder class - appends captured operations to a trace file. Records are encoded into a
+// buffer that is written out every few kilobytes, so capture costs a few hundred nanoseconds per
+// operation.
+class TraceRecorder {
+private:
+    ofstream out;
+    string buffer;
+    mutex recordMutex;
+    chrono::steady_clock::time_point started;
+    long long previousMicros = 0;
+    long long previousWhen = 0;
+    long long records = 0;
+
+    void drain() {
+        out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+    // Op byte, arrival gap and clock; the caller holds recordMutex
+    void putHeader(TraceOp op, bool applied, time_t when) {
+        long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+        buffer.push_back(static_cast<char>(op | (applied ? TrafficTrace::APPLIED : 0)));
+        HistoryArchive::putVarint(buffer, static_cast<unsigned long long>(max(0LL, micros - previousMicros)));
+        HistoryArchive::putSigned(buffer, static_cast<long long>(when) - previousWhen);
+        previousMicros = max(previousMicros, micros);
+        previousWhen = static_cast<long long>(when);
+    }
+
+public:
+    explicit TraceRecorder(const string& filename, time_t start) : out(filename, ios::binary), started(chrono::steady_clock::now()) {
+        buffer.append(TrafficTrace::MAGIC, 4);
+        HistoryArchive::putVarint(buffer, TrafficTrace::FORMAT_VERSION);
+        previousWhen = static_cast<long long>(start);
+        HistoryArchive::putSigned(buffer, previousWhen);
+    }
+
+    bool isOpen() const { return out.is_open(); }
+
+    // Appends one operation; record.atMicros is ignored, the recorder stamps the arrival itself
+    void record(const TraceRecord& record) {
+        lock_guard<mutex> guard(recordMutex);
+        putHeader(record.op, record.applied, record.when);
+        unsigned char fields = TrafficTrace::fieldsOf(record.op);
+        if (fields & TrafficTrace::ACCOUNT) {
+            HistoryArchive::putSigned(buffer, record.account);
+        }
+        if (fields & TrafficTrace::OTHER) {
+            HistoryArchive::putSigned(buffer, record.other);
+        }
+        if (fields & TrafficTrace::AMOUNT) {
+            HistoryArchive::putSigned(buffer, record.amount.getCents());
+        }
+        if (fields & TrafficTrace::DUE) {
+            HistoryArchive::putSigned(buffer, record.due - static_cast<long long>(record.when));
+        }
+        if (fields & TrafficTrace::PERIOD) {
+            HistoryArchive::putSigned(buffer, record.period);
+        }
+        if (fields & TrafficTrace::TEXT) {
+            HistoryArchive::putVarint(buffer, record.text.size());
+            for (const string& text : record.text) {
+                HistoryArchive::putText(buffer, text);
+            }
+        }
+        records++;
+        if (buffer.size() >= 16 * 1024) {
+            drain();
+        }
+    }
+
+    // Closes the trace with the book it should replay to as of when; false if the file could not
+    // be written
+    bool finish(time_t when, const vector<pair<int, Money>>& balances, const vector<pair<int, Money>>& loans) {
+        lock_guard<mutex> guard(recordMutex);
+        putHeader(TRACE_END, false, when);
+        for (const vector<pair<int, Money>>* book : { &balances, &loans }) {
+            HistoryArchive::putVarint(buffer, book->size());
+            for (const pair<int, Money>& entry : *book) {
+                HistoryArchive::putSigned(buffer, entry.first);
+                HistoryArchive::putSigned(buffer, entry.second.getCents());
+            }
+        }
+        drain();
+        out.close();
+        return !out.fail();
+    }
+
+    long long getRecordCount() const { return records; }
+};
+
+// TraceReader class - loads a whole trace into memory and decodes it record by record, so a replay
+// measures the bank rather than the disk
+class TraceReader {
+private:
+    vector<unsigned char> data;
+    const unsigned char* at = nullptr;
+    const unsigned char* end = nullptr;
+    time_t startTime = 0;
+    long long previousMicros = 0;
+    long long previousWhen = 0;
+    string error;
+    vector<pair<int, Money>> expectedBalances;
+    vector<pair<int, Money>> expectedLoans;
+
+    bool fail(const string& message) {
+        error = message;
+        at = end;
+        return false;
+    }
+
+    bool readBook(vector<pair<int, Money>>& book) {
+        unsigned long long count;
+        if (!HistoryArchive::getVarint(at, end, count) || count > static_cast<unsigned long long>(end - at)) {
+            return false;
+        }
+        for (unsigned long long i = 0; i < count; i++) {
+            long long number, cents;
+            if (!HistoryArchive::getSigned(at, end, number) || !HistoryArchive::getSigned(at, end, cents)) {
+                return false;
+            }
+            book.emplace_back(static_cast<int>(number), Money::fromCents(cents));
+        }
+        return true;
+    }
+
+    bool readFields(TraceRecord& record) {
+        unsigned char fields = TrafficTrace::fieldsOf(record.op);
+        long long account = 0, other = 0, cents = 0, due = 0, period = 0;
+        if (((fields & TrafficTrace::ACCOUNT) && !HistoryArchive::getSigned(at, end, account))
+            || ((fields & TrafficTrace::OTHER) && !HistoryArchive::getSigned(at, end, other))
+            || ((fields & TrafficTrace::AMOUNT) && !HistoryArchive::getSigned(at, end, cents))
+            || ((fields & TrafficTrace::DUE) && !HistoryArchive::getSigned(at, end, due))
+            || ((fields & TrafficTrace::PERIOD) && !HistoryArchive::getSigned(at, end, period))) {
+            return false;
+        }
+        record.account = static_cast<int>(account);
+        record.other = static_cast<int>(other);
+        record.amount = Money::fromCents(cents);
+        record.due = static_cast<long long>(record.when) + due;
+        record.period = period;
+        record.text.clear();
+        if (fields & TrafficTrace::TEXT) {
+            unsigned long long count;
+            if (!HistoryArchive::getVarint(at, end, count) || count > static_cast<unsigned long long>(end - at)) {
+                return false;
+            }
+            record.text.resize(static_cast<size_t>(count));
+            for (string& text : record.text) {
+                if (!HistoryArchive::getText(at, end, text)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+public:
+    bool open(const string& filename) {
+        ifstream in(filename, ios::binary);
+        if (!in) {
+            return fail("cannot open " + filename);
+        }
+        data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        at = data.data();
+        end = at + data.size();
+        unsigned long long version = 0;
+        if (data.size() < 4 || memcmp(at, TrafficTrace::MAGIC, 4) != 0) {
+            return fail(filename + " is not a traffic trace");
+        }
+        at += 4;
+        if (!HistoryArchive::getVarint(at, end, version) || version != TrafficTrace::FORMAT_VERSION) {
+            return fail("unsupported trace version " + to_string(version));
+        }
+        if (!HistoryArchive::getSigned(at, end, previousWhen)) {
+            return fail("trace header is truncated");
+        }
+        startTime = static_cast<time_t>(previousWhen);
+        return true;
+    }
+
+    // False after the last record, with record.when set to the closing clock and the expected book
+    // loaded, or on damage (see getError)
+    bool next(TraceRecord& record) {
+        if (at == end) {
+            return fail(error.empty() ? "trace ends before its closing book" : error);
+        }
+        unsigned char opByte = *at++;
+        record.op = static_cast<TraceOp>(opByte & ~TrafficTrace::APPLIED);
+        record.applied = (opByte & TrafficTrace::APPLIED) != 0;
+        if (record.op > TrafficTrace::LAST_OP) {
+            return fail("unknown operation " + to_string(record.op));
+        }
+        unsigned long long gap;
+        long long when;
+        if (!HistoryArchive::getVarint(at, end, gap) || !HistoryArchive::getSigned(at, end, when)) {
+            return fail("trace is truncated");
+        }
+        previousMicros += static_cast<long long>(gap);
+        previousWhen += when;
+        record.atMicros = previousMicros;
+        record.when = static_cast<time_t>(previousWhen);
+        if (record.op == TRACE_END) {
+            if (!readBook(expectedBalances) || !readBook(expectedLoans)) {
+                return fail("closing book is damaged");
+            }
+            at = end;
+            return false;
+        }
+        if (!readFields(record)) {
+            return fail("trace is truncated");
+        }
+        return true;
+    }
+
+    time_t getStartTime() const { return startTime; }
+    const string& getError() const { return error; }
+    const vector<pair<int, Money>>& getExpectedBalances() const { return expectedBalances; }
+    const vector<pair<int, Money>>& getExpectedLoans() const { return expectedLoans; }
+};
+
+// AccountBalance - one account's balance inside a checkpoint or point-in-time book
+struct AccountBalance {
+    int accountNumber;
+    Money balance;
+
+    bool operator<(const AccountBalance& other) const { return accountNumber < other.accountNumber; }
+};
+
+// BalanceJournal class - append-only log of every balance change plus periodic checkpoints of all
+// open balances. A point-in-time query loads the newest checkpoint at or before T and replays only
+// the journal entries after it, so the checkpoint interval trades memory against query latency.
+// Deposits a hot account takes into its credit stripes are journaled when they are folded into the
+// balance, so as-of queries on hot accounts date those credits to the fold, not the deposit.
+class BalanceJournal {
+private:
+    enum EntryKind : unsigned char { CHANGE = 0, OPEN = 1, CLOSE = 2 };
+
+    struct Entry {
+        time_t time;
+        int accountNumber;
+        EntryKind kind;
+        Money delta;
+    };
+
+    struct Checkpoint {
+        time_t time;
+        size_t journalPosition;
+        vector<AccountBalance> balances;
+    };
+
+    vector<Entry> entries;
+    vector<Checkpoint> checkpoints;
+    unordered_map<int, Money> liveBalances;
+    size_t checkpointInterval;
+    size_t entriesSinceCheckpoint;
+    time_t historyStart;
+
+    void append(time_t now, int accountNumber, EntryKind kind, Money delta) {
+        Entry entry;
+        entry.time = now;
+        entry.accountNumber = accountNumber;
+        entry.kind = kind;
+        entry.delta = delta;
+        entries.push_back(entry);
+        entriesSinceCheckpoint++;
+        if (entriesSinceCheckpoint >= checkpointInterval) {
+            takeCheckpoint(now);
+        }
+    }
+
+    // Newest checkpoint taken at or before the given time; the baseline checkpoint always qualifies
+    const Checkpoint& checkpointFor(time_t when) const {
+        auto it = upper_bound(checkpoints.begin(), checkpoints.end(), when,
+            [](time_t value, const Checkpoint& checkpoint) { return value < checkpoint.time; });
+        return *(it - 1);
+    }
+
+public:
+    static const size_t DEFAULT_CHECKPOINT_INTERVAL = 1024;
+
+    BalanceJournal() : checkpointInterval(DEFAULT_CHECKPOINT_INTERVAL), entriesSinceCheckpoint(0), historyStart(0) {
+        reset(currentTime());
+    }
+
+    // Drops all history; the current live balances (none) become the baseline at the given time
+    void reset(time_t now) {
+        entries.clear();
+        checkpoints.clear();
+        liveBalances.clear();
+        historyStart = now;
+        takeCheckpoint(now);
+    }
+
+    void takeCheckpoint(time_t now) {
+        Checkpoint checkpoint;
+        checkpoint.time = now;
+        checkpoint.journalPosition = entries.size();
+        checkpoint.balances.reserve(liveBalances.size());
+        for (const auto& live : liveBalances) {
+            checkpoint.balances.push_back(AccountBalance{ live.first, live.second });
+        }
+        sort(checkpoint.balances.begin(), checkpoint.balances.end());
+        checkpoints.push_back(move(checkpoint));
+        entriesSinceCheckpoint = 0;
+    }
+
+    void recordOpen(int accountNumber, Money balance, time_t now) {
+        liveBalances[accountNumber] = balance;
+        append(now, accountNumber, OPEN, balance);
+    }
+
+    void recordChange(int accountNumber, Money delta, time_t now) {
+        if (delta == Money()) {
+            return;
+        }
+        liveBalances[accountNumber] += delta;
+        append(now, accountNumber, CHANGE, delta);
+    }
+
+    void recordClose(int accountNumber, time_t now) {
+        liveBalances.erase(accountNumber);
+        append(now, accountNumber, CLOSE, Money());
+    }
+
+    void setCheckpointInterval(size_t interval) {
+        checkpointInterval = interval > 0 ? interval : 1;
+    }
+
+    size_t getCheckpointInterval() const { return checkpointInterval; }
+    size_t getEntryCount() const { return entries.size(); }
+    size_t getCheckpointCount() const { return checkpoints.size(); }
+    time_t getHistoryStart() const { return historyStart; }
+
+    size_t checkpointBytes() const {
+        size_t bytes = 0;
+        for (const Checkpoint& checkpoint : checkpoints) {
+            bytes += sizeof(Checkpoint) + checkpoint.balances.capacity() * sizeof(AccountBalance);
+        }
+        return bytes;
+    }
+
+    size_t journalBytes() const { return entries.capacity() * sizeof(Entry); }
+
+    // False when the account was not open at that time or the time predates recorded history
+    bool balanceAsOf(int accountNumber, time_t when, Money& balance) const {
+        if (when < historyStart) {
+            return false;
+        }
+        const Checkpoint& checkpoint = checkpointFor(when);
+        auto found = lower_bound(checkpoint.balances.begin(), checkpoint.balances.end(), AccountBalance{ accountNumber, Money() });
+        bool open = found != checkpoint.balances.end() && found->accountNumber == accountNumber;
+        balance = open ? found->balance : Money();
+        for (size_t i = checkpoint.journalPosition; i < entries.size() && entries[i].time <= when; i++) {
+            const Entry& entry = entries[i];
+            if (entry.accountNumber != accountNumber) {
+                continue;
+            }
+            if (entry.kind == OPEN) {
+                open = true;
+                balance = entry.delta;
+            }
+            else if (entry.kind == CLOSE) {
+                open = false;
+                balance = Money();
+            }
+            else {
+                balance += entry.delta;
+            }
+        }
+        return open;
+    }
+
+    // Every account open at the given time with its balance, ordered by account number
+    bool bookAsOf(time_t when, vector<AccountBalance>& book) const {
+        book.clear();
+        if (when < historyStart) {
+            return false;
+        }
+        const Checkpoint& checkpoint = checkpointFor(when);
+        map<int, Money> balances;
+        for (const AccountBalance& entry : checkpoint.balances) {
+            balances.emplace_hint(balances.end(), entry.accountNumber, entry.balance);
+        }
+        for (size_t i = checkpoint.journalPosition; i < entries.size() && entries[i].time <= when; i++) {
+            const Entry& entry = entries[i];
+            if (entry.kind == OPEN) {
+                balances[entry.accountNumber] = entry.delta;
+            }
+            else if (entry.kind == CLOSE) {
+                balances.erase(entry.accountNumber);
+            }
+            else {
+                balances[entry.accountNumber] += entry.delta;
+            }
+        }
+        book.reserve(balances.size());
+        for (const auto& entry : balances) {
+            book.push_back(AccountBalance{ entry.first, entry.second });
+        }
+        return true;
+    }
+
+    MemoryUsage memoryUsage() const {
+        return MemoryUsage{ "Balance journal", static_cast<long long>(entries.size() + checkpoints.size()),
+            static_cast<long long>(journalBytes() + checkpointBytes() + hashTableBytes(liveBalances)) };
+    }
+};
+
+// StandingOrder - a transfer that runs on a schedule. A one-off future-dated transfer is an order
+// with no repeat interval; it is dropped once it has fired.
+struct StandingOrder {
+    int orderID = 0;
+    int fromAccount = 0;
+    int toAccount = 0;
+    Money amount;
+    time_t nextDue = 0;
+    long long intervalSeconds = 0;
+};
+
+// TimerWheel class - hierarchical timing wheel of four levels of 256 slots over one-second ticks.
+// Scheduling drops an entry into the slot for its due tick and turning the wheel empties one slot per
+// tick, so both are O(1) per entry however many are pending. Entries more than 256 ticks out wait on
+// a coarser level and cascade down a level each time the finer wheel wraps, as in the classic
+// Varghese and Lauck design.
+class TimerWheel {
+public:
+    struct Entry {
+        long long due;
+        int id;
+    };
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const long long SLOT_MASK = SLOTS - 1;
+    static const long long HORIZON = 1LL << (SLOT_BITS * LEVELS);
+
+    vector<Entry> slots[LEVELS][SLOTS];
+    vector<Entry> overdue;
+    long long currentTick;
+    size_t pendingCount;
+
+    void place(const Entry& entry) {
+        long long delta = entry.due - currentTick;
+        if (delta < 0) {
+            overdue.push_back(entry);
+            return;
+        }
+        // Anything past the top level's reach parks at its far edge and is placed again on cascade
+        long long placeAt = delta < HORIZON ? entry.due : currentTick + HORIZON - 1;
+        int level = 0;
+        while (level < LEVELS - 1 && placeAt - currentTick >= (1LL << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        slots[level][(placeAt >> (SLOT_BITS * level)) & SLOT_MASK].push_back(entry);
+    }
+
+    // Re-places the entries of one coarse slot; they land on finer levels now that they are closer
+    void cascade(int level) {
+        vector<Entry> moving;
+        moving.swap(slots[level][(currentTick >> (SLOT_BITS * level)) & SLOT_MASK]);
+        for (const Entry& entry : moving) {
+            place(entry);
+        }
+    }
+
+public:
+    explicit TimerWheel(long long startTick = 0) : currentTick(startTick), pendingCount(0) {}
+
+    void schedule(int id, long long due) {
+        place(Entry{ due, id });
+        pendingCount++;
+    }
+
+    // Appends every entry due at or before the given tick to fired, in due order
+    void advance(long long tick, vector<Entry>& fired) {
+        fired.insert(fired.end(), overdue.begin(), overdue.end());
+        pendingCount -= overdue.size();
+        overdue.clear();
+        while (currentTick <= tick) {
+            if (pendingCount == 0) {
+                currentTick = tick + 1;
+                break;
+            }
+            long long index = currentTick & SLOT_MASK;
+            for (int level = 1; index == 0 && level < LEVELS; level++) {
+                index = (currentTick >> (SLOT_BITS * level)) & SLOT_MASK;
+                cascade(level);
+            }
+            vector<Entry>& slot = slots[0][currentTick & SLOT_MASK];
+            fired.insert(fired.end(), slot.begin(), slot.end());
+            pendingCount -= slot.size();
+            slot.clear();
+            currentTick++;
+        }
+    }
+
+    void reset(long long startTick) {
+        for (int level = 0; level < LEVELS; level++) {
+            for (int slot = 0; slot < SLOTS; slot++) {
+                vector<Entry>().swap(slots[level][slot]);
+            }
+        }
+        overdue.clear();
+        currentTick = startTick;
+        pendingCount = 0;
+    }
+
+    size_t pending() const { return pendingCount; }
+
+    size_t memoryBytes() const {
+        size_t bytes = sizeof(TimerWheel) + overdue.capacity() * sizeof(Entry);
+        for (int level = 0; level < LEVELS; level++) {
+            for (int slot = 0; slot < SLOTS; slot++) {
+                bytes += slots[level][slot].capacity() * sizeof(Entry);
+            }
+        }
+        return bytes;
+    }
+};
+
+// SchedulerStats - running totals for the standing order scheduler. Lag is how long after its due
+// time an order actually ran.
+struct SchedulerStats {
+    long long fired = 0;
+    long long executed = 0;
+    long long failed = 0;
+    long long missed = 0;
+    long long batches = 0;
+    double totalLagSeconds = 0.0;
+    double maxLagSeconds = 0.0;
+    double busySeconds = 0.0;
+
+    double averageLagSeconds() const { return fired > 0 ? totalLagSeconds / fired : 0.0; }
+    double firedPerSecond() const { return busySeconds > 0 ? fired / busySeconds : 0.0; }
+};
+
+// TransferScheduler class - standing orders keyed by ID with a TimerWheel of due times. Cancelling
+// only erases the order; its wheel entry is recognised as stale when it fires and is ignored.
+class TransferScheduler {
+private:
+    TimerWheel wheel;
+    unordered_map<int, StandingOrder> orders;
+    int nextOrderID;
+    SchedulerStats stats;
+    vector<TimerWheel::Entry> fired;
+
+public:
+    explicit TransferScheduler(time_t start = currentTime()) : wheel(start), nextOrderID(1) {}
+
+    int add(StandingOrder order) {
+        order.orderID = nextOrderID++;
+        orders[order.orderID] = order;
+        wheel.schedule(order.orderID, order.nextDue);
+        return order.orderID;
+    }
+
+    bool cancel(int orderID) {
+        return orders.erase(orderID) > 0;
+    }
+
+    const StandingOrder* find(int orderID) const {
+        auto found = orders.find(orderID);
+        return found == orders.end() ? nullptr : &found->second;
+    }
+
+    // Hands out every order due by now. A repeating order is rescheduled for its first occurrence
+    // after now: occurrences missed while the bank was not running are counted, not replayed.
+    void takeDue(time_t now, vector<StandingOrder>& due) {
+        fired.clear();
+        wheel.advance(now, fired);
+        for (const TimerWheel::Entry& entry : fired) {
+            auto found = orders.find(entry.id);
+            if (found == orders.end() || found->second.nextDue != entry.due) {
+                continue;
+            }
+            StandingOrder& order = found->second;
+            due.push_back(order);
+            double lag = static_cast<double>(now - order.nextDue);
+            stats.fired++;
+            stats.totalLagSeconds += lag;
+            stats.maxLagSeconds = max(stats.maxLagSeconds, lag);
+            if (order.intervalSeconds > 0) {
+                long long missed = (now - order.nextDue) / order.intervalSeconds;
+                stats.missed += missed;
+                order.nextDue += static_cast<time_t>((missed + 1) * order.intervalSeconds);
+                wheel.schedule(order.orderID, order.nextDue);
+            }
+            else {
+                orders.erase(found);
+            }
+        }
+    }
+
+    void recordBatch(long long executed, long long failed, double seconds) {
+        stats.batches++;
+        stats.executed += executed;
+        stats.failed += failed;
+        stats.busySeconds += seconds;
+    }
+
+    // Orders sorted by ID, for listings and snapshots
+    vector<StandingOrder> list() const {
+        vector<StandingOrder> result;
+        result.reserve(orders.size());
+        for (const auto& entry : orders) {
+            result.push_back(entry.second);
+        }
+        sort(result.begin(), result.end(),
+            [](const StandingOrder& a, const StandingOrder& b) { return a.orderID < b.orderID; });
+        return result;
+    }
+
+    // Replaces every order, e.g. after a load; IDs are kept as saved
+    void restore(const vector<StandingOrder>& saved, int savedNextID, time_t now) {
+        orders.clear();
+        wheel.reset(now);
+        nextOrderID = savedNextID;
+        for (const StandingOrder& order : saved) {
+            orders[order.orderID] = order;
+            wheel.schedule(order.orderID, order.nextDue);
+            nextOrderID = max(nextOrderID, order.orderID + 1);
+        }
+    }
+
+    size_t size() const { return orders.size(); }
+    int getNextOrderID() const { return nextOrderID; }
+    const SchedulerStats& getStats() const { return stats; }
+
+    MemoryUsage memoryUsage() const {
+        return MemoryUsage{ "Standing orders", static_cast<long long>(orders.size()),
+            static_cast<long long>(hashTableBytes(orders) + wheel.memoryBytes() + fired.capacity() * sizeof(TimerWheel::Entry)) };
+    }
+};
+
+// Session - an account signed in with its PIN. The token handed out is the session's serial number
+// followed by a random secret; the serial finds the session, the secret proves the caller was given it.
+struct Session {
+    int serial;
+    unsigned long long secret;
+    int accountNumber;
+    time_t expires;
+    long long uses;
+};
+
+// SessionStats - running totals for the session layer
+struct SessionStats {
+    long long opened = 0;
+    long long validated = 0;
+    long long rejected = 0;
+    long long expired = 0;
+    long long closed = 0;
+};
+
+// SessionManager class - short-lived tokens that stand in for the PIN after one successful check.
+// Checking a token is one hash lookup and a compare. Every use pushes the expiry back by the idle
+// timeout; a TimerWheel reclaims sessions once they lapse, and a wheel entry for a session used since
+// it was set is simply rescheduled when it fires, so the wheel is touched once per timeout rather
+// than once per use. Expiry is also checked on every use, so a lapsed session is refused even before
+// the wheel gets to it.
+class SessionManager {
+public:
+    static const int TOKEN_LENGTH = 24;
+    static const long long DEFAULT_TIMEOUT_SECONDS = 300;
+
+private:
+    TimerWheel wheel;
+    unordered_map<int, Session> sessions;
+    int nextSerial;
+    long long timeoutSeconds;
+    // Secrets come straight from the system's entropy source; a seeded engine would let one
+    // observed token predict the ones issued after it
+    random_device secrets;
+    SessionStats stats;
+    vector<TimerWheel::Entry> fired;
+
+    static string formatToken(const Session& session) {
+        char token[TOKEN_LENGTH + 1];
+        snprintf(token, sizeof(token), "%08x%016llx", static_cast<unsigned>(session.serial), session.secret);
+        return string(token, TOKEN_LENGTH);
+    }
+
+    static bool parseToken(string_view token, int& serial, unsigned long long& secret) {
+        unsigned serialBits = 0;
+        if (token.size() != TOKEN_LENGTH
+            || from_chars(token.data(), token.data() + 8, serialBits, 16).ptr != token.data() + 8
+            || from_chars(token.data() + 8, token.data() + TOKEN_LENGTH, secret, 16).ptr != token.data() + TOKEN_LENGTH) {
+            return false;
+        }
+        serial = static_cast<int>(serialBits);
+        return true;
+    }
+
+    unsigned long long nextSecret() {
+        unsigned long long high = secrets();
+        return (high << 32) | secrets();
+    }
+
+public:
+    explicit SessionManager(time_t start = currentTime())
+        : wheel(start), nextSerial(1), timeoutSeconds(DEFAULT_TIMEOUT_SECONDS) {}
+
+    // Signs an account in; the caller has already checked the PIN
+    string open(int accountNumber, time_t now) {
+        expire(now);
+        Session session{ nextSerial++, nextSecret(), accountNumber, now + static_cast<time_t>(timeoutSeconds), 0 };
+        sessions[session.serial] = session;
+        wheel.schedule(session.serial, session.expires);
+        stats.opened++;
+        return formatToken(session);
+    }
+
+    // True when the token names a live session for this account; the session's expiry moves back
+    bool validate(string_view token, int accountNumber, time_t now) {
+        int serial = 0;
+        unsigned long long secret = 0;
+        if (!parseToken(token, serial, secret)) {
+            stats.rejected++;
+            return false;
+        }
+        auto found = sessions.find(serial);
+        if (found == sessions.end() || found->second.secret != secret || found->second.accountNumber != accountNumber
+            || found->second.expires <= now) {
+            stats.rejected++;
+            return false;
+        }
+        found->second.expires = now + static_cast<time_t>(timeoutSeconds);
+        found->second.uses++;
+        stats.validated++;
+        return true;
+    }
+
+    const Session* find(string_view token) const {
+        int serial = 0;
+        unsigned long long secret = 0;
+        if (!parseToken(token, serial, secret)) {
+            return nullptr;
+        }
+        auto found = sessions.find(serial);
+        return found == sessions.end() || found->second.secret != secret ? nullptr : &found->second;
+    }
+
+    bool close(string_view token) {
+        const Session* session = find(token);
+        if (!session) {
+            return false;
+        }
+        sessions.erase(session->serial);
+        stats.closed++;
+        return true;
+    }
+
+    // Ends every session for an account, e.g. when it is closed
+    int closeAccount(int accountNumber) {
+        int ended = 0;
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            if (it->second.accountNumber == accountNumber) {
+                it = sessions.erase(it);
+                ended++;
+            }
+            else {
+                ++it;
+            }
+        }
+        stats.closed += ended;
+        return ended;
+    }
+
+    // Drops sessions idle past the timeout. Returns how many lapsed.
+    int expire(time_t now) {
+        fired.clear();
+        wheel.advance(now, fired);
+        int lapsed = 0;
+        for (const TimerWheel::Entry& entry : fired) {
+            auto found = sessions.find(entry.id);
+            if (found == sessions.end()) {
+                continue;
+            }
+            if (found->second.expires > now) {
+                wheel.schedule(entry.id, found->second.expires);
+                continue;
+            }
+            sessions.erase(found);
+            lapsed++;
+        }
+        stats.expired += lapsed;
+        return lapsed;
+    }
+
+    void clear(time_t now) {
+        stats.closed += static_cast<long long>(sessions.size());
+        sessions.clear();
+        wheel.reset(now);
+    }
+
+    // Applies to sessions from their next use on
+    void setTimeout(long long seconds) { timeoutSeconds = seconds; }
+    long long getTimeout() const { return timeoutSeconds; }
+    size_t size() const { return sessions.size(); }
+    const SessionStats& getStats() const { return stats; }
+
+    MemoryUsage memoryUsage() const {
+        return MemoryUsage{ "Sessions", static_cast<long long>(sessions.size()),
+            static_cast<long long>(hashTableBytes(sessions) + wheel.memoryBytes() + fired.capacity() * sizeof(TimerWheel::Entry)) };
+    }
+};
+
+// AccountIdentity - the parts of an account that never change once it is opened. The identity owns
+// the Account object itself, so a closed or replaced account stays alive until the last snapshot that
+// can still see it is released.
+struct AccountIdentity {
+    int accountNumber;
+    string accountType;
+    int customerID;
+    string customerName;
+    shared_ptr<const Account> account;
+};
+
+// AccountState - one published version of an account's mutable state. Savings accounts also carry
+// their accrual position so readers can show interest earned but not yet posted.
+struct AccountState {
+    shared_ptr<const AccountIdentity> identity;
+    Money balance;
+    int transactionCount = 0;
+    long long rateMicros = 0;
+    time_t lastAccrual = 0;
+    Money accruedInterest;
+
+    void capture(const Account* account) {
+        balance = account->getBalance();
+        transactionCount = account->getTransactionCount();
+        const SavingsAccount* savings = dynamic_cast<const SavingsAccount*>(account);
+        if (savings) {
+            rateMicros = savings->getInterestRateMicros();
+            lastAccrual = savings->getLastAccrual();
+            accruedInterest = savings->getAccruedInterest();
+        }
+    }
+
+    bool accruesInterest() const { return identity->accountType == "Savings"; }
+
+    // Unposted interest as of now; zero for accounts that do not earn interest
+    Money interestAsOf(time_t now) const {
+        if (!accruesInterest()) {
+            return Money();
+        }
+        return accruedInterest + balance.accrueDays(rateMicros, SavingsAccount::wholeDaysBetween(lastAccrual, now));
+    }
+
+    Money balanceAsOf(time_t now) const { return balance + interestAsOf(now); }
+};
+
+// BookImage - immutable point-in-time view of balances, loans and ledger position. Accounts are held
+// in fixed-size chunks so a writer copies only the chunk it touches, never the whole book.
+struct BookImage {
+    static const int CHUNK_SIZE = 16;
+
+    struct Chunk {
+        AccountState states[CHUNK_SIZE];
+    };
+
+    long long version = 0;
+    string bankName;
+    int accountCount = 0;
+    vector<shared_ptr<const Chunk>> chunks;
+    shared_ptr<const vector<Loan>> loans;
+    shared_ptr<const vector<StandingOrder>> standingOrders = make_shared<const vector<StandingOrder>>();
+    int nextStandingOrderID = 1;
+    int nextAccountNumber = 0;
+    int nextCustomerID = 0;
+    int nextTransactionID = 0;
+    int nextLoanID = 0;
+
+    const AccountState& account(int slot) const {
+        return chunks[slot / CHUNK_SIZE]->states[slot % CHUNK_SIZE];
+    }
+};
+
+// BookSnapshots class - copy-on-write publisher of BookImages. Writers (serialized by the bank) build
+// the next image beside the current one and swap it in; readers take a reference to whatever image
+// is current and are never blocked by, nor block, the writers that follow.
+class BookSnapshots {
+private:
+    shared_ptr<const BookImage> current;
+    mutable mutex pointerMutex;
+    unordered_map<int, int> slots;
+    unordered_map<int, shared_ptr<const AccountIdentity>> identities;
+
+    static AccountState stateOf(const Account* account, const shared_ptr<const AccountIdentity>& identity) {
+        AccountState state;
+        state.identity = identity;
+        state.capture(account);
+        return state;
+    }
+
+    static void stampLedger(BookImage& image, long long version) {
+        image.version = version;
+        image.nextAccountNumber = Account::getNextAccountNumber();
+        image.nextCustomerID = Customer::getNextCustomerID();
+        image.nextTransactionID = Transaction::getNextTransactionID();
+        image.nextLoanID = Loan::getNextLoanID();
+    }
+
+    void swapIn(shared_ptr<const BookImage> next) {
+        lock_guard<mutex> lock(pointerMutex);
+        current.swap(next);
+    }
+
+public:
+    BookSnapshots() : current(make_shared<BookImage>()) {}
+
+    shared_ptr<const BookImage> acquire() const {
+        lock_guard<mutex> lock(pointerMutex);
+        return current;
+    }
+
+    // Full rebuild after accounts are opened, closed or loaded and slots shift. Accounts seen here for
+    // the first time are adopted by a new identity; accounts no longer listed are dropped with theirs.
+    void rebuild(const string& bankName, Account* const* accounts, int accountCount, Loan* const* loans, int loanCount) {
+        shared_ptr<const BookImage> previous = acquire();
+        shared_ptr<BookImage> next = make_shared<BookImage>();
+        next->bankName = bankName;
+        unordered_map<int, shared_ptr<const AccountIdentity>> keptIdentities;
+        slots.clear();
+        next->accountCount = accountCount;
+        for (int first = 0; first < accountCount; first += BookImage::CHUNK_SIZE) {
+            shared_ptr<BookImage::Chunk> chunk = make_shared<BookImage::Chunk>();
+            for (int slot = first; slot < accountCount && slot < first + BookImage::CHUNK_SIZE; slot++) {
+                const Account* account = accounts[slot];
+                int accNum = account->getAccountNumber();
+                auto found = identities.find(accNum);
+                shared_ptr<const AccountIdentity> identity;
+                if (found != identities.end() && found->second->account.get() == account) {
+                    identity = found->second;
+                }
+                else {
+                    identity = make_shared<const AccountIdentity>(AccountIdentity{ accNum, account->getAccountType(),
+                        account->getCustomerRef().getCustomerID(), account->getCustomerRef().getName(),
+                        shared_ptr<const Account>(account) });
+                }
+                keptIdentities[accNum] = identity;
+                chunk->states[slot - first] = stateOf(account, identity);
+                slots[accNum] = slot;
+            }
+            next->chunks.push_back(chunk);
+        }
+        identities.swap(keptIdentities);
+        shared_ptr<vector<Loan>> loanStates = make_shared<vector<Loan>>();
+        for (int i = 0; i < loanCount; i++) {
+            loanStates->push_back(*loans[i]);
+        }
+        next->loans = loanStates;
+        next->standingOrders = previous->standingOrders;
+        next->nextStandingOrderID = previous->nextStandingOrderID;
+        stampLedger(*next, previous->version + 1);
+        swapIn(next);
+    }
+
+    // Publishes new versions of the given accounts together, copying only the chunks they live in
+    void publishAccounts(const Account* const* changed, int changedCount) {
+        shared_ptr<const BookImage> previous = acquire();
+        shared_ptr<BookImage> next = make_shared<BookImage>(*previous);
+        vector<pair<int, shared_ptr<BookImage::Chunk>>> copies;
+        for (int i = 0; i < changedCount; i++) {
+            auto found = slots.find(changed[i]->getAccountNumber());
+            if (found == slots.end()) {
+                continue;
+            }
+            int chunkIndex = found->second / BookImage::CHUNK_SIZE;
+            size_t copy = 0;
+            while (copy < copies.size() && copies[copy].first != chunkIndex) {
+                copy++;
+            }
+            if (copy == copies.size()) {
+                copies.emplace_back(chunkIndex, make_shared<BookImage::Chunk>(*next->chunks[chunkIndex]));
+                next->chunks[chunkIndex] = copies[copy].second;
+            }
+            copies[copy].second->states[found->second % BookImage::CHUNK_SIZE].capture(changed[i]);
+        }
+        stampLedger(*next, previous->version + 1);
+        swapIn(next);
+    }
+
+    void publishLoans(Loan* const* loans, int loanCount) {
+        shared_ptr<const BookImage> previous = acquire();
+        shared_ptr<BookImage> next = make_shared<BookImage>(*previous);
+        shared_ptr<vector<Loan>> loanStates = make_shared<vector<Loan>>();
+        loanStates->reserve(loanCount);
+        for (int i = 0; i < loanCount; i++) {
+            loanStates->push_back(*loans[i]);
+        }
+        next->loans = loanStates;
+        stampLedger(*next, previous->version + 1);
+        swapIn(next);
+    }
+
+    void publishStandingOrders(vector<StandingOrder> orders, int nextOrderID) {
+        shared_ptr<const BookImage> previous = acquire();
+        shared_ptr<BookImage> next = make_shared<BookImage>(*previous);
+        next->standingOrders = make_shared<const vector<StandingOrder>>(move(orders));
+        next->nextStandingOrderID = nextOrderID;
+        stampLedger(*next, previous->version + 1);
+        swapIn(next);
+    }
+
+    // The current image and the identity table behind it. Older images still held by readers are
+    // not counted; they share every chunk a writer has not replaced since.
+    MemoryUsage memoryUsage() const {
+        shared_ptr<const BookImage> image = acquire();
+        size_t bytes = sizeof(BookImage) + stringHeapBytes(image->bankName)
+            + image->chunks.capacity() * sizeof(shared_ptr<const BookImage::Chunk>)
+            + image->chunks.size() * sizeof(BookImage::Chunk)
+            + image->loans->capacity() * sizeof(Loan) + image->standingOrders->capacity() * sizeof(StandingOrder)
+            + hashTableBytes(slots) + hashTableBytes(identities);
+        for (const auto& entry : identities) {
+            bytes += sizeof(AccountIdentity) + stringHeapBytes(entry.second->accountType) + stringHeapBytes(entry.second->customerName);
+        }
+        return MemoryUsage{ "Published snapshot", static_cast<long long>(image->chunks.size()), static_cast<long long>(bytes) };
+    }
+};
+
+// Optional sections may follow the loans in a save file, each introduced by its title line. Files
+// written before a section existed simply end sooner and load with that section's defaults.
+const char* const INTEREST_ACCRUAL_SECTION = "[Interest Accrual]";
+const char* const STANDING_ORDERS_SECTION = "[Standing Orders]";
+
+// Serializes a snapshot in the Bank::saveToFile/loadFromFile format
+void writeBookImage(const BookImage& image, ostream& outFile) {
+    outFile << image.bankName << '\n';
+    outFile << image.accountCount << '\n';
+    outFile << image.nextAccountNumber << '\n';
+    outFile << image.nextCustomerID << '\n';
+    outFile << image.nextTransactionID << '\n';
+    outFile << image.loans->size() << '\n';
+    outFile << image.nextLoanID << '\n';
+    for (int i = 0; i < image.accountCount; i++) {
+        const AccountState& state = image.account(i);
+        outFile << state.identity->accountType << '\n';
+        state.identity->account->saveState(outFile, state.balance, state.transactionCount);
+    }
+    for (const Loan& loan : *image.loans) {
+        loan.saveToFile(outFile);
+    }
+    int accruing = 0;
+    for (int i = 0; i < image.accountCount; i++) {
+        accruing += image.account(i).accruesInterest() ? 1 : 0;
+    }
+    outFile << INTEREST_ACCRUAL_SECTION << '\n';
+    outFile << accruing << '\n';
+    for (int i = 0; i < image.accountCount; i++) {
+        const AccountState& state = image.account(i);
+        if (state.accruesInterest()) {
+            outFile << state.identity->accountNumber << '\n';
+            outFile << static_cast<long long>(state.lastAccrual) << '\n';
+            outFile << state.accruedInterest << '\n';
+        }
+    }
+    outFile << STANDING_ORDERS_SECTION << '\n';
+    outFile << image.standingOrders->size() << '\n';
+    outFile << image.nextStandingOrderID << '\n';
+    for (const StandingOrder& order : *image.standingOrders) {
+        outFile << order.orderID << '\n';
+        outFile << order.fromAccount << '\n';
+        outFile << order.toAccount << '\n';
+        outFile << order.amount << '\n';
+        outFile << static_cast<long long>(order.nextDue) << '\n';
+        outFile << order.intervalSeconds << '\n';
+    }
+}
+
+// CheckpointStats - running totals for the background checkpointer
+struct CheckpointStats {
+    long long written = 0;
+    long long skipped = 0;
+    long long failed = 0;
+    long long lastVersion = 0;
+    long long lastBytes = 0;
+    double lastMillis = 0.0;
+    double totalMillis = 0.0;
+    double maxMillis = 0.0;
+    double lastStallMicros = 0.0;
+    double totalStallMicros = 0.0;
+    double maxStallMicros = 0.0;
+};
+
+// BackgroundCheckpointer class - writes the current snapshot to disk on a schedule from its own thread.
+// Capturing a checkpoint is one pointer copy under the snapshot lock; that is the only moment it can
+// hold up a writer, and it is reported as stall time. The file is written to a temporary name and
+// renamed into place so a crash mid-write never leaves a torn checkpoint.
+class BackgroundCheckpointer {
+private:
+    const BookSnapshots& snapshots;
+    thread worker;
+    mutable mutex controlMutex;
+    condition_variable wake;
+    bool running;
+    bool stopRequested;
+    bool checkpointRequested;
+    string filename;
+    int intervalMillis;
+    CheckpointStats stats;
+
+    void loop() {
+        unique_lock<mutex> lock(controlMutex);
+        while (!stopRequested) {
+            wake.wait_for(lock, chrono::milliseconds(intervalMillis),
+                [this] { return stopRequested || checkpointRequested; });
+            if (stopRequested) {
+                break;
+            }
+            checkpointRequested = false;
+            string target = filename;
+            long long lastVersion = stats.lastVersion;
+            lock.unlock();
+            CheckpointStats result = writeCheckpoint(target, lastVersion);
+            lock.lock();
+            record(result);
+        }
+    }
+
+    CheckpointStats writeCheckpoint(const string& target, long long lastVersion) const {
+        CheckpointStats result;
+        auto started = chrono::steady_clock::now();
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        result.lastStallMicros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+        result.lastVersion = image->version;
+        if (image->version == lastVersion) {
+            result.skipped = 1;
+            return result;
+        }
+        string temporary = target + ".tmp";
+        {
+            ofstream outFile(temporary, ios::binary);
+            if (outFile) {
+                writeBookImage(*image, outFile);
+                result.lastBytes = static_cast<long long>(outFile.tellp());
+            }
+            if (!outFile) {
+                result.failed = 1;
+                return result;
+            }
+        }
+        error_code ec;
+        filesystem::rename(temporary, target, ec);
+        if (ec) {
+            result.failed = 1;
+            return result;
+        }
+        result.written = 1;
+        result.lastMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return result;
+    }
+
+    void record(const CheckpointStats& result) {
+        stats.totalStallMicros += result.lastStallMicros;
+        stats.maxStallMicros = max(stats.maxStallMicros, result.lastStallMicros);
+        stats.lastStallMicros = result.lastStallMicros;
+        if (result.skipped) {
+            stats.skipped++;
+            return;
+        }
+        if (result.failed) {
+            stats.failed++;
+            return;
+        }
+        stats.written++;
+        stats.lastVersion = result.lastVersion;
+        stats.lastBytes = result.lastBytes;
+        stats.lastMillis = result.lastMillis;
+        stats.totalMillis += result.lastMillis;
+        stats.maxMillis = max(stats.maxMillis, result.lastMillis);
+    }
+
+public:
+    explicit BackgroundCheckpointer(const BookSnapshots& source)
+        : snapshots(source), running(false), stopRequested(false), checkpointRequested(false), intervalMillis(60000) {}
+
+    ~BackgroundCheckpointer() { stop(); }
+
+    BackgroundCheckpointer(const BackgroundCheckpointer&) = delete;
+    BackgroundCheckpointer& operator=(const BackgroundCheckpointer&) = delete;
+
+    // Starts the thread, or just changes the schedule and target when it is already running
+    void start(const string& target, int everyMillis) {
+        lock_guard<mutex> lock(controlMutex);
+        filename = target;
+        intervalMillis = everyMillis > 0 ? everyMillis : 1;
+        if (!running) {
+            running = true;
+            stopRequested = false;
+            worker = thread(&BackgroundCheckpointer::loop, this);
+        }
+        wake.notify_all();
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> lock(controlMutex);
+            if (!running) {
+                return;
+            }
+            stopRequested = true;
+        }
+        wake.notify_all();
+        worker.join();
+        lock_guard<mutex> lock(controlMutex);
+        running = false;
+    }
+
+    void requestCheckpoint() {
+        lock_guard<mutex> lock(controlMutex);
+        checkpointRequested = true;
+        wake.notify_all();
+    }
+
+    bool isRunning() const {
+        lock_guard<mutex> lock(controlMutex);
+        return running;
+    }
+
+    CheckpointStats getStats() const {
+        lock_guard<mutex> lock(controlMutex);
+        return stats;
+    }
+
+    void displayStats() const {
+        lock_guard<mutex> lock(controlMutex);
+        cout << "\n--- Background Checkpointer ---" << endl;
+        if (running) {
+            cout << "Status: running, every " << formatDouble(intervalMillis / 1000.0) << " s to " << filename << endl;
+        }
+        else {
+            cout << "Status: stopped" << endl;
+        }
+        cout << "Checkpoints Written: " << stats.written << " (skipped unchanged: " << stats.skipped
+            << ", failed: " << stats.failed << ")" << endl;
+        if (stats.written > 0) {
+            cout << "Last Checkpoint: version " << stats.lastVersion << ", " << stats.lastBytes << " bytes, "
+                << formatDouble(stats.lastMillis) << " ms" << endl;
+            cout << "Checkpoint Duration: avg " << formatDouble(stats.totalMillis / stats.written) << " ms, max "
+                << formatDouble(stats.maxMillis) << " ms" << endl;
+        }
+        long long captures = stats.written + stats.skipped + stats.failed;
+        if (captures > 0) {
+            cout << "Capture Stall: avg " << formatDouble(stats.totalStallMicros / captures) << " us, max "
+                << formatDouble(stats.maxStallMicros) << " us" << endl;
+        }
+    }
+};
+
+// ReconciliationFinding - one broken or unverifiable invariant
+struct ReconciliationFinding {
+    string check;
+    int accountNumber = 0;
+    int reference = 0;
+    Money expected;
+    Money actual;
+    string detail;
+
+    bool operator<(const ReconciliationFinding& other) const {
+        return tie(check, accountNumber, reference) < tie(other.check, other.accountNumber, other.reference);
+    }
+};
+
+// ReconciliationStats - what one reconciliation run covered and found
+struct ReconciliationStats {
+    int accounts = 0;
+    long long transactions = 0;
+    long long transfers = 0;
+    int loans = 0;
+    int balanceBreaks = 0;
+    long long transferBreaks = 0;
+    int loanBreaks = 0;
+    int unverified = 0;
+    int threads = 0;
+    double seconds = 0.0;
+
+    long long breaks() const { return balanceBreaks + transferBreaks + loanBreaks; }
+
+    double transactionsPerSecond() const {
+        return seconds > 0.0 ? transactions / seconds : 0.0;
+    }
+};
+
+// Reconciler class - checks the invariants that tie a book snapshot together:
+//   - every account's balance equals the net effect of its recorded history
+//   - every Transfer memo appears in both accounts, each backed by the matching Withdrawal/Deposit
+//   - every loan has a matching disbursement and a balance its terms allow
+// Accounts are scanned in parallel; transfer legs are then grouped by transaction ID in parallel
+// partitions, so no lane ever waits on another. Findings are written to the report in sorted order.
+class Reconciler {
+private:
+    struct TransferLeg {
+        int transactionID;
+        int accountNumber;
+        int fromAccount;
+        int toAccount;
+        Money amount;
+        bool backed;
+
+        bool operator<(const TransferLeg& other) const {
+            return tie(transactionID, accountNumber) < tie(other.transactionID, other.accountNumber);
+        }
+    };
+
+    struct AccountFacts {
+        bool historyFull;
+        int customerID;
+    };
+
+    int threadCount;
+
+    static bool backedBy(const AccountState& state, int index, const char* type, Money amount) {
+        if (index == 0) {
+            return false;
+        }
+        const Transaction& previous = state.identity->account->getTransaction(index - 1);
+        return previous.getType() == type && previous.getAmount() == amount;
+    }
+
+    static ReconciliationFinding finding(const char* check, int accountNumber, int reference,
+                                         Money expected, Money actual, const string& detail) {
+        ReconciliationFinding result;
+        result.check = check;
+        result.accountNumber = accountNumber;
+        result.reference = reference;
+        result.expected = expected;
+        result.actual = actual;
+        result.detail = detail;
+        return result;
+    }
+
+    static void writeFinding(ReportWriter& out, const ReconciliationFinding& item) {
+        out.column(item.check, 10).separator();
+        out.integerColumn(item.accountNumber, 8).separator();
+        out.integerColumn(item.reference, 8).separator();
+        out.moneyColumn(item.expected, 14).separator();
+        out.moneyColumn(item.actual, 14).separator();
+        out.text(item.detail).newline();
+    }
+
+public:
+    explicit Reconciler(int threads) : threadCount(threads) {}
+
+    void run(const BookImage& image, ReportWriter& out, ReconciliationStats& stats) const {
+        auto started = chrono::steady_clock::now();
+        WorkerPool pool(threadCount);
+        int lanes = pool.size();
+        int partitions = lanes * 4;
+        vector<vector<ReconciliationFinding>> laneFindings(lanes);
+        vector<vector<vector<TransferLeg>>> legs(lanes, vector<vector<TransferLeg>>(partitions));
+        vector<vector<pair<int, Money>>> disbursements(lanes);
+        vector<long long> laneTransactions(lanes, 0);
+        vector<int> laneUnverified(lanes, 0);
+        vector<int> laneBalanceBreaks(lanes, 0);
+        vector<int> laneLoanBreaks(lanes, 0);
+
+        unordered_map<int, AccountFacts> facts;
+        for (int i = 0; i < image.accountCount; i++) {
+            const AccountState& state = image.account(i);
+            facts[state.identity->accountNumber] = AccountFacts{ state.transactionCount >= MAX_TRANSACTIONS,
+                                                                 state.identity->customerID };
+        }
+
+        // Pass 1: each account on its own, reading only the history its published state covers
+        pool.parallelFor(image.accountCount, [&](int lane, int slot) {
+            const AccountState& state = image.account(slot);
+            const Account* account = state.identity->account.get();
+            int accNum = state.identity->accountNumber;
+            Money net;
+            for (int i = 0; i < state.transactionCount; i++) {
+                const Transaction& transaction = account->getTransaction(i);
+                net += transaction.balanceEffect(accNum);
+                const string& type = transaction.getType();
+                if (type == "Transfer") {
+                    bool outgoing = transaction.getFromAccount() == accNum;
+                    TransferLeg leg{ transaction.getTransactionID(), accNum, transaction.getFromAccount(),
+                                     transaction.getToAccount(), transaction.getAmount(),
+                                     backedBy(state, i, outgoing ? "Withdrawal" : "Deposit", transaction.getAmount()) };
+                    legs[lane][leg.transactionID % partitions].push_back(leg);
+                }
+                else if (type == "Loan Disbursement") {
+                    if (!backedBy(state, i, "Deposit", transaction.getAmount())) {
+                        laneLoanBreaks[lane]++;
+                        laneFindings[lane].push_back(finding("Loan", accNum, transaction.getTransactionID(),
+                            transaction.getAmount(), Money(), "disbursement memo has no matching deposit"));
+                    }
+                    disbursements[lane].emplace_back(state.identity->customerID, transaction.getAmount());
+                }
+            }
+            laneTransactions[lane] += state.transactionCount;
+            if (net != state.balance) {
+                if (state.transactionCount >= MAX_TRANSACTIONS) {
+                    laneUnverified[lane]++;
+                    laneFindings[lane].push_back(finding("Balance", accNum, 0, net, state.balance,
+                        "unverified: history is full, later entries were not recorded"));
+                }
+                else {
+                    laneBalanceBreaks[lane]++;
+                    laneFindings[lane].push_back(finding("Balance", accNum, 0, net, state.balance,
+                        "balance differs from the net of recorded history"));
+                }
+            }
+        });
+
+        // Pass 2: each partition pairs the legs of the transfers whose IDs hash to it
+        vector<vector<ReconciliationFinding>> partitionFindings(partitions);
+        vector<long long> partitionTransfers(partitions, 0);
+        vector<long long> partitionBreaks(partitions, 0);
+        vector<int> partitionUnverified(partitions, 0);
+        pool.parallelFor(partitions, [&](int, int partition) {
+            vector<TransferLeg> group;
+            for (int lane = 0; lane < lanes; lane++) {
+                group.insert(group.end(), legs[lane][partition].begin(), legs[lane][partition].end());
+            }
+            sort(group.begin(), group.end());
+            vector<ReconciliationFinding>& found = partitionFindings[partition];
+            size_t i = 0;
+            while (i < group.size()) {
+                size_t end = i;
+                while (end < group.size() && group[end].transactionID == group[i].transactionID) {
+                    end++;
+                }
+                const TransferLeg& first = group[i];
+                partitionTransfers[partition]++;
+                bool broken = false;
+                const TransferLeg* debit = nullptr;
+                const TransferLeg* credit = nullptr;
+                for (size_t j = i; j < end; j++) {
+                    if (group[j].accountNumber == group[j].fromAccount) {
+                        debit = &group[j];
+                    }
+                    else {
+                        credit = &group[j];
+                    }
+                    if (!group[j].backed) {
+                        broken = true;
+                        found.push_back(finding("Transfer", group[j].accountNumber, group[j].transactionID, group[j].amount,
+                            Money(), group[j].accountNumber == group[j].fromAccount ? "memo not backed by a withdrawal"
+                                                                                     : "memo not backed by a deposit"));
+                    }
+                }
+                if (debit && credit && debit->amount != credit->amount) {
+                    broken = true;
+                    found.push_back(finding("Transfer", debit->accountNumber, first.transactionID, debit->amount,
+                        credit->amount, "legs disagree on the amount"));
+                }
+                if (!debit || !credit) {
+                    int missing = debit ? first.toAccount : first.fromAccount;
+                    auto counterparty = facts.find(missing);
+                    if (counterparty == facts.end()) {
+                        // The other account was closed; its history went with it
+                    }
+                    else if (counterparty->second.historyFull) {
+                        partitionUnverified[partition]++;
+                        found.push_back(finding("Transfer", missing, first.transactionID, first.amount, Money(),
+                            "unverified: counterparty history is full"));
+                    }
+                    else {
+                        broken = true;
+                        found.push_back(finding("Transfer", missing, first.transactionID, first.amount, Money(),
+                            "leg missing from this account"));
+                    }
+                }
+                if (broken) {
+                    partitionBreaks[partition]++;
+                }
+                i = end;
+            }
+        });
+
+        // Pass 3: loans against their terms and the disbursements seen in pass 1
+        map<pair<int, long long>, int> unclaimed;
+        for (const auto& laneList : disbursements) {
+            for (const auto& entry : laneList) {
+                unclaimed[make_pair(entry.first, entry.second.getCents())]++;
+            }
+        }
+        unordered_map<int, bool> customerHistoryFull;
+        for (const auto& entry : facts) {
+            customerHistoryFull[entry.second.customerID] = customerHistoryFull[entry.second.customerID] || entry.second.historyFull;
+        }
+        vector<ReconciliationFinding> loanFindings;
+        for (const Loan& loan : *image.loans) {
+            bool broken = false;
+            Money total = loan.getTotalRepayable();
+            if (loan.getRemainingBalance() < Money() || loan.getRemainingBalance() > total) {
+                broken = true;
+                loanFindings.push_back(finding("Loan", loan.getCustomerID(), loan.getLoanID(), total,
+                    loan.getRemainingBalance(), "remaining balance outside 0 to principal plus interest"));
+            }
+            if (loan.getDurationMonths() <= 0 || loan.getMonthlyPayment() != total.dividedBy(loan.getDurationMonths())) {
+                broken = true;
+                loanFindings.push_back(finding("Loan", loan.getCustomerID(), loan.getLoanID(),
+                    loan.getDurationMonths() > 0 ? total.dividedBy(loan.getDurationMonths()) : Money(),
+                    loan.getMonthlyPayment(), "monthly payment does not match the terms"));
+            }
+            auto claim = unclaimed.find(make_pair(loan.getCustomerID(), loan.getPrincipal().getCents()));
+            if (claim != unclaimed.end() && claim->second > 0) {
+                claim->second--;
+            }
+            else if (customerHistoryFull.count(loan.getCustomerID()) == 0 && !loan.isActive()) {
+                // Repaid loan whose accounts have since been closed
+            }
+            else if (customerHistoryFull[loan.getCustomerID()]) {
+                stats.unverified++;
+                loanFindings.push_back(finding("Loan", loan.getCustomerID(), loan.getLoanID(), loan.getPrincipal(),
+                    Money(), "unverified: customer history is full"));
+            }
+            else {
+                broken = true;
+                loanFindings.push_back(finding("Loan", loan.getCustomerID(), loan.getLoanID(), loan.getPrincipal(),
+                    Money(), "no matching disbursement in the customer's accounts"));
+            }
+            if (broken) {
+                stats.loanBreaks++;
+            }
+        }
+
+        vector<ReconciliationFinding> findings;
+        for (int lane = 0; lane < lanes; lane++) {
+            findings.insert(findings.end(), laneFindings[lane].begin(), laneFindings[lane].end());
+            stats.transactions += laneTransactions[lane];
+            stats.unverified += laneUnverified[lane];
+            stats.balanceBreaks += laneBalanceBreaks[lane];
+            stats.loanBreaks += laneLoanBreaks[lane];
+        }
+        for (int partition = 0; partition < partitions; partition++) {
+            findings.insert(findings.end(), partitionFindings[partition].begin(), partitionFindings[partition].end());
+            stats.transfers += partitionTransfers[partition];
+            stats.transferBreaks += partitionBreaks[partition];
+            stats.unverified += partitionUnverified[partition];
+        }
+        findings.insert(findings.end(), loanFindings.begin(), loanFindings.end());
+        sort(findings.begin(), findings.end());
+        stats.accounts = image.accountCount;
+        stats.loans = static_cast<int>(image.loans->size());
+        stats.threads = lanes;
+        stats.seconds = secondsSince(started);
+
+        out.text("=== Reconciliation Report ===\n");
+        out.text("Bank: ").text(image.bankName).newline();
+        out.text("Snapshot Version: ").integer(image.version).newline();
+        out.text("Run At: ").text(getCurrentDateTime()).newline();
+        out.text("Accounts: ").integer(stats.accounts).text(", Transactions: ").integer(stats.transactions);
+        out.text(", Transfers: ").integer(stats.transfers).text(", Loans: ").integer(stats.loans).newline().newline();
+        out.column("Check", 10).separator().column("Acc/Cust", 8).separator().column("Ref", 8).separator();
+        out.column("Expected", 14).separator().column("Actual", 14).separator().text("Detail\n");
+        out.line(100);
+        for (const ReconciliationFinding& item : findings) {
+            writeFinding(out, item);
+        }
+        if (findings.empty()) {
+            out.text("No findings. Every invariant holds.\n");
+        }
+        out.line(100);
+        out.text("Balance breaks: ").integer(stats.balanceBreaks).text(", Transfer breaks: ").integer(stats.transferBreaks);
+        out.text(", Loan breaks: ").integer(stats.loanBreaks).text(", Unverified: ").integer(stats.unverified).newline();
+    }
+};
+
+// Helper functions for input. Tokens are parsed with from_chars and must be numeric in full;
+// end of input reads as 0, which backs out of every menu and finally exits.
+int getIntInput() {
+    string token;
+    int value;
+    while (cin >> token) {
+        if (InputScanner::parseInt(token, value)) {
+            return value;
+        }
+        clearInputBuffer();
+        cout << "Invalid input. Please enter a number: ";
+    }
+    return 0;
+}
+
+Money getMoneyInput() {
+    string token;
+    Money value;
+    while (cin >> token) {
+        if (Money::parse(token, value)) {
+            return value;
+        }
+        clearInputBuffer();
+        cout << "Invalid input. Please enter an amount: ";
+    }
+    return Money();
+}
+
+string getPinInput() {
+    string pin;
+    clearInputBuffer();
+    cout << "Enter 4-digit PIN: ";
+    getline(cin, pin);
+    return pin;
+}
+
+// Bank class
+class Bank {
+private:
+    Account* accounts[MAX_ACCOUNTS];
+    Loan* loans[MAX_LOANS];
+    int accountCount;
+    int loanCount;
+    string bankName;
+    AccountIndex accountIndex;
+    VelocityEngine velocity;
+    BalanceJournal journal;
+    BookSnapshots snapshots;
+    BackgroundCheckpointer checkpointer;
+    TransferScheduler scheduler;
+    vector<StandingOrder> dueOrders;
+    SessionManager sessions;
+    // Session this console is signed in with, and the sessions a batch run opened with 'login'
+    string terminalSession;
+    unordered_map<int, string> batchSessions;
+    // Set while client traffic is being captured to a trace file
+    unique_ptr<TraceRecorder> recorder;
+    // Accounts that have credit stripes, hot now or made hot at some point
+    vector<Account*> stripedAccounts;
+    // Savings accounts whose balance changed since the last month-end interest run. Only these
+    // can have interest worth posting then; the rest accrue lazily until they are next used.
+    unordered_set<SavingsAccount*> touchedSavings;
+    // Serializes writers with each other; readers of published snapshots never take it
+    mutable mutex bookMutex;
+
+    void publish(const Account* first, const Account* second = nullptr) {
+        const Account* changed[2] = { first, second };
+        snapshots.publishAccounts(changed, second ? 2 : 1);
+    }
+
+    void republishAll() {
+        snapshots.rebuild(bankName, accounts, accountCount, loans, loanCount);
+    }
+
+    void publishStandingOrders() {
+        snapshots.publishStandingOrders(scheduler.list(), scheduler.getNextOrderID());
+    }
+
+    void capture(const TraceRecord& record) {
+        if (recorder) {
+            recorder->record(record);
+        }
+    }
+
+    void capture(TraceOp op, int account, int other, Money amount, bool applied, time_t when) {
+        if (recorder) {
+            TraceRecord record;
+            record.op = op;
+            record.applied = applied;
+            record.when = when;
+            record.account = account;
+            record.other = other;
+            record.amount = amount;
+            recorder->record(record);
+        }
+    }
+
+    void captureVelocityRule(int accountNumber, const VelocityRule& rule, time_t when) {
+        if (recorder) {
+            TraceRecord record;
+            record.op = TRACE_VELOCITY_RULE;
+            record.applied = true;
+            record.when = when;
+            record.account = accountNumber;
+            record.other = rule.maxOperations;
+            record.amount = rule.maxAmount;
+            record.period = rule.windowSeconds;
+            recorder->record(record);
+        }
+    }
+
+    // Single hook for every balance change: re-keys the indexes and journals the delta
+    void noteBalanceChange(Account* account, Money balanceBefore) {
+        Money delta = account->getBalance() - balanceBefore;
+        if (delta == Money()) {
+            return;
+        }
+        journal.recordChange(account->getAccountNumber(), delta, currentTime());
+        accountIndex.updateBalance(account);
+        if (account->getAccountType() == "Savings") {
+            touchedSavings.insert(static_cast<SavingsAccount*>(account));
+        }
+    }
+
+    // Drains an account's credit stripes into its balance as one Deposit entry, journaled at the time
+    // of the fold. The caller holds bookMutex and publishes; returns false when there was nothing to fold.
+    bool foldHotCredits(Account* account) {
+        SplitBalance* stripes = account->getCreditStripes();
+        if (!stripes) {
+            return false;
+        }
+        long long credits = 0;
+        Money total = stripes->drain(credits);
+        if (total == Money()) {
+            return false;
+        }
+        Money before = account->getBalance();
+        account->creditFolded(total);
+        noteBalanceChange(account, before);
+        return true;
+    }
+
+    static bool creditAllowed(const Account* account, Money amount) {
+        if (account->canCredit(amount)) {
+            return true;
+        }
+        cout << "Credit refused! Account " << account->getAccountNumber() << " would hold more than $"
+            << Money::fromCents(Money::MAX_CENTS) << "." << endl;
+        return false;
+    }
+
+    // A debit only needs the stripes folded in when the settled balance alone cannot cover it under
+    // the account's own rule (minimum balance or overdraft)
+    bool foldIfShort(Account* account, Money amount) {
+        return account->availableToDebit() < amount && foldHotCredits(account);
+    }
+
+    // Posts the interest a savings account has accrued since it was last used. Called on every
+    // access, so an account's interest is caught up the moment anyone looks at or moves its balance.
+    // Returns true when interest was posted and the account needs publishing.
+    bool settleInterest(Account* account, time_t now) {
+        SavingsAccount* savings = dynamic_cast<SavingsAccount*>(account);
+        if (!savings) {
+            return false;
+        }
+        Money before = savings->getBalance();
+        if (!savings->postAccruedInterest(now)) {
+            return false;
+        }
+        noteBalanceChange(savings, before);
+        return true;
+    }
+
+    static void displayAccountHeader(ReportWriter& out) {
+        out.column("Acc No.", 10).separator();
+        out.column("Type", 10).separator();
+        out.column("Customer Name", 20).separator();
+        out.column("Balance", 12).newline();
+        out.line(60);
+    }
+
+    static void displayAccountRow(ReportWriter& out, const Account* account) {
+        out.integerColumn(account->getAccountNumber(), 10).separator();
+        out.column(account->getAccountType(), 10).separator();
+        out.column(account->getCustomerRef().getName(), 20).separator();
+        out.moneyColumn(account->getBalance(), 12).newline();
+    }
+
+    // Snapshot rows include interest earned but not yet posted, so they agree with what the account
+    // will show once it is next used
+    static void displayAccountRow(ReportWriter& out, const AccountState& state, time_t now) {
+        out.integerColumn(state.identity->accountNumber, 10).separator();
+        out.column(state.identity->accountType, 10).separator();
+        out.column(state.identity->customerName, 20).separator();
+        out.moneyColumn(state.balanceAsOf(now), 12).newline();
+    }
+
+public:
+    Bank(string name = "OOP Banking System") : accountCount(0), loanCount(0), bankName(name), checkpointer(snapshots) {
+        for (int i = 0; i < MAX_ACCOUNTS; i++) {
+            accounts[i] = nullptr;
+        }
+        for (int i = 0; i < MAX_LOANS; i++) {
+            loans[i] = nullptr;
+        }
+        republishAll();
+        cout << "Welcome to " << bankName << "!" << endl;
+    }
+
+    // Accounts are owned by their snapshot identities and are freed together with the snapshots
+    ~Bank() {
+        checkpointer.stop();
+        for (int i = 0; i < loanCount; i++) {
+            if (loans[i] != nullptr) {
+                delete loans[i];
+                loans[i] = nullptr;
+            }
+        }
+    }
+
+    bool isPinUnique(const string& pin) const {
+        for (int i = 0; i < accountCount; i++) {
+            if (accounts[i] && accounts[i]->getCustomer().getPin() == pin) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool verifyCustomerPin(int accountNumber, const string& pin) const {
+        Account* account = findAccount(accountNumber);
+        if (account && account->getCustomer().getPin() == pin) {
+            return true;
+        }
+        cout << "Invalid PIN!" << endl;
+        return false;
+    }
+
+    // Signs an account in with its PIN and returns the session token, or an empty string
+    string signIn(int accountNumber, const string& pin) {
+        if (!findAccount(accountNumber) || !verifyCustomerPin(accountNumber, pin)) {
+            return string();
+        }
+        lock_guard<mutex> guard(bookMutex);
+        return sessions.open(accountNumber, currentTime());
+    }
+
+    bool signOut(const string& token) {
+        lock_guard<mutex> guard(bookMutex);
+        return sessions.close(token);
+    }
+
+    // A credential is either the account's PIN or a session token signed in to the account
+    bool authorize(int accountNumber, const string& credential) {
+        if (credential.size() != SessionManager::TOKEN_LENGTH) {
+            return verifyCustomerPin(accountNumber, credential);
+        }
+        lock_guard<mutex> guard(bookMutex);
+        if (sessions.validate(credential, accountNumber, currentTime())) {
+            return true;
+        }
+        cout << "Session expired or not signed in to account " << accountNumber << "!" << endl;
+        return false;
+    }
+
+    // Console operations on the account this terminal is signed in to go ahead on its session. Any
+    // other account asks for the PIN once and signs the terminal in to it instead.
+    bool authenticate(int accountNumber) {
+        if (!terminalSession.empty()) {
+            lock_guard<mutex> guard(bookMutex);
+            const Session* session = sessions.find(terminalSession);
+            if (session && session->accountNumber == accountNumber
+                && sessions.validate(terminalSession, accountNumber, currentTime())) {
+                return true;
+            }
+        }
+        string pin = getPinInput();
+        string token = signIn(accountNumber, pin);
+        if (token.empty()) {
+            return false;
+        }
+        if (!terminalSession.empty()) {
+            signOut(terminalSession);
+        }
+        terminalSession = token;
+        cout << "Signed in to account " << accountNumber << "; the session ends after " << sessions.getTimeout()
+            << " seconds without use." << endl;
+        return true;
+    }
+
+    int expireSessions(time_t now) {
+        lock_guard<mutex> guard(bookMutex);
+        return sessions.expire(now);
+    }
+
+    void createAccount() {
+        if (accountCount >= MAX_ACCOUNTS) {
+            cout << "Maximum number of accounts reached!" << endl;
+            return;
+        }
+        Customer customer;
+        customer.inputDetails();
+        string pin;
+        bool validPin = false;
+        while (!validPin) {
+            pin = getPinInput();
+            if (!isValidPin(pin)) {
+                cout << "PIN must be exactly 4 digits!" << endl;
+                continue;
+            }
+            if (!isPinUnique(pin)) {
+                cout << "PIN already in use! Please choose a different PIN." << endl;
+                continue;
+            }
+            validPin = true;
+        }
+        customer.setPin(pin);
+        int choice;
+        Money initialDeposit;
+        cout << "\nSelect Account Type:" << endl;
+        cout << "1. Savings Account" << endl;
+        cout << "2. Current Account" << endl;
+        cout << "Enter choice (1-2): ";
+        choice = getIntInput();
+        cout << "Enter initial deposit amount: $";
+        initialDeposit = getMoneyInput();
+        if (choice != 1 && choice != 2) {
+            cout << "Invalid choice! Account creation failed." << endl;
+            return;
+        }
+        Account* newAccount = openAccount(customer, choice == 1 ? "Savings" : "Current", initialDeposit);
+        if (!newAccount) {
+            return;
+        }
+        cout << "\n" << newAccount->getAccountType() << " Account created successfully!" << endl;
+        cout << "Account Number: " << newAccount->getAccountNumber() << endl;
+    }
+
+    // Creates and registers an account without prompting; returns nullptr when the bank is full
+    Account* openAccount(const Customer& customer, const string& accountType, Money initialDeposit) {
+        time_t when = currentTime();
+        Account* newAccount = registerAccount(customer, accountType, initialDeposit);
+        if (recorder) {
+            TraceRecord record;
+            record.op = TRACE_OPEN_ACCOUNT;
+            record.applied = newAccount != nullptr;
+            record.when = when;
+            record.account = newAccount ? newAccount->getAccountNumber() : 0;
+            record.other = customer.getCustomerID();
+            record.amount = initialDeposit;
+            record.text = { accountType, customer.getName(), customer.getAddress(), customer.getPhone(), customer.getPin() };
+            capture(record);
+        }
+        return newAccount;
+    }
+
+    Account* registerAccount(const Customer& customer, const string& accountType, Money initialDeposit) {
+        lock_guard<mutex> guard(bookMutex);
+        if (accountCount >= MAX_ACCOUNTS) {
+            cout << "Maximum number of accounts reached!" << endl;
+            return nullptr;
+        }
+        Account* newAccount = nullptr;
+        if (accountType == "Savings") {
+            newAccount = new SavingsAccount(customer, initialDeposit);
+        }
+        else if (accountType == "Current") {
+            newAccount = new CurrentAccount(customer, initialDeposit);
+        }
+        else {
+            cout << "Unknown account type: " << accountType << endl;
+            return nullptr;
+        }
+        accounts[accountCount] = newAccount;
+        accountCount++;
+        accountIndex.insert(newAccount);
+        journal.recordOpen(newAccount->getAccountNumber(), newAccount->getBalance(), currentTime());
+        republishAll();
+        return newAccount;
+    }
+
+    Account* findAccount(int accountNumber) const {
+        for (int i = 0; i < accountCount; i++) {
+            if (accounts[i] && accounts[i]->getAccountNumber() == accountNumber) {
+                return accounts[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void closeAccount(int accountNumber) {
+        time_t when = currentTime();
+        bool closed = removeAccount(accountNumber);
+        capture(TRACE_CLOSE_ACCOUNT, accountNumber, 0, Money(), closed, when);
+    }
+
+    // Closes an account unless its customer has an active loan; false when it was not closed
+    bool removeAccount(int accountNumber) {
+        lock_guard<mutex> guard(bookMutex);
+        for (int i = 0; i < accountCount; i++) {
+            if (accounts[i] && accounts[i]->getAccountNumber() == accountNumber) {
+                int custID = accounts[i]->getCustomer().getCustomerID();
+                for (int j = 0; j < loanCount; j++) {
+                    if (loans[j] && loans[j]->getCustomerID() == custID && loans[j]->isActive()) {
+                        cout << "Cannot close account. Customer has an active loan." << endl;
+                        return false;
+                    }
+                }
+                foldHotCredits(accounts[i]);
+                stripedAccounts.erase(remove(stripedAccounts.begin(), stripedAccounts.end(), accounts[i]), stripedAccounts.end());
+                cout << "Account " << accountNumber << " closed." << endl;
+                accountIndex.remove(accountNumber);
+                velocity.forgetAccount(accountNumber);
+                sessions.closeAccount(accountNumber);
+                touchedSavings.erase(static_cast<SavingsAccount*>(accounts[i]));
+                journal.recordClose(accountNumber, currentTime());
+                for (int j = i; j < accountCount - 1; j++) {
+                    accounts[j] = accounts[j + 1];
+                }
+                accounts[accountCount - 1] = nullptr;
+                accountCount--;
+                republishAll();
+                return true;
+            }
+        }
+        cout << "Account " << accountNumber << " not found!" << endl;
+        return false;
+    }
+
+    void depositToAccount(int accountNumber, Money amount) {
+        Account* account = findAccount(accountNumber);
+        if (!account) {
+            cout << "Account " << accountNumber << " not found!" << endl;
+            return;
+        }
+        if (!authenticate(accountNumber)) {
+            return;
+        }
+        time_t when = currentTime();
+        capture(TRACE_DEPOSIT, accountNumber, 0, amount, executeDeposit(account, amount), when);
+    }
+
+    void withdrawFromAccount(int accountNumber, Money amount) {
+        Account* account = findAccount(accountNumber);
+        if (!account) {
+            cout << "Account " << accountNumber << " not found!" << endl;
+            return;
+        }
+        if (!authenticate(accountNumber)) {
+            return;
+        }
+        time_t when = currentTime();
+        capture(TRACE_WITHDRAWAL, accountNumber, 0, amount, executeWithdrawal(account, amount), when);
+    }
+
+    void transferBetweenAccounts(int fromAccNum, int toAccNum, Money amount) {
+        if (fromAccNum == toAccNum) {
+            cout << "Cannot transfer to the same account!" << endl;
+            return;
+        }
+        Account* fromAccount = findAccount(fromAccNum);
+        Account* toAccount = findAccount(toAccNum);
+        if (!fromAccount) {
+            cout << "Source account " << fromAccNum << " not found!" << endl;
+            return;
+        }
+        if (!toAccount) {
+            cout << "Destination account " << toAccNum << " not found!" << endl;
+            return;
+        }
+        if (!authenticate(fromAccNum)) {
+            return;
+        }
+        time_t when = currentTime();
+        capture(TRACE_TRANSFER, fromAccNum, toAccNum, amount, executeTransfer(fromAccount, toAccount, amount), when);
+    }
+
+    // Post-authentication operation paths shared by the menu, benchmarks and batch callers.
+    // They apply velocity limits and keep the secondary indexes in step with every balance change.
+    bool executeDeposit(Account* account, Money amount) {
+        if (amount <= Money()) {
+            cout << "Invalid deposit amount!" << endl;
+            return false;
+        }
+        // Hot accounts take the credit into this thread's stripe without the writer lock
+        SplitBalance* stripes = account->hotCredits();
+        if (stripes) {
+            if (!creditAllowed(account, amount)) {
+                return false;
+            }
+            stripes->credit(amount);
+            cout << "Deposit of $" << amount << " to account " << account->getAccountNumber() << " accepted." << endl;
+            return true;
+        }
+        lock_guard<mutex> guard(bookMutex);
+        settleInterest(account, currentTime());
+        if (!creditAllowed(account, amount)) {
+            return false;
+        }
+        Money before = account->getBalance();
+        account->deposit(amount);
+        noteBalanceChange(account, before);
+        publish(account);
+        return true;
+    }
+
+    bool executeWithdrawal(Account* account, Money amount) {
+        lock_guard<mutex> guard(bookMutex);
+        time_t now = currentTime();
+        if (amount > Money() && !velocity.allowDebit(account->getAccountNumber(), amount, now)) {
+            return false;
+        }
+        bool settled = settleInterest(account, now);
+        settled = foldIfShort(account, amount) || settled;
+        Money before = account->getBalance();
+        if (!account->withdraw(amount)) {
+            if (settled) {
+                publish(account);
+            }
+            return false;
+        }
+        velocity.recordDebit(account->getAccountNumber(), amount, now);
+        noteBalanceChange(account, before);
+        publish(account);
+        return true;
+    }
+
+    bool executeTransfer(Account* fromAccount, Account* toAccount, Money amount) {
+        if (fromAccount->getAccountNumber() == toAccount->getAccountNumber()) {
+            cout << "Cannot transfer to the same account!" << endl;
+            return false;
+        }
+        lock_guard<mutex> guard(bookMutex);
+        bool touched = false;
+        bool transferred = applyTransfer(fromAccount, toAccount, amount, currentTime(), touched);
+        if (touched) {
+            publish(fromAccount, toAccount);
+        }
+        return transferred;
+    }
+
+    // Transfer rules shared by interactive and scheduled transfers. The caller holds bookMutex and
+    // publishes; touched is set when either balance moved, even if the transfer itself was refused.
+    bool applyTransfer(Account* fromAccount, Account* toAccount, Money amount, time_t now, bool& touched) {
+        int fromAccNum = fromAccount->getAccountNumber();
+        if (amount > Money() && !velocity.allowDebit(fromAccNum, amount, now)) {
+            return false;
+        }
+        touched = settleInterest(fromAccount, now) || touched;
+        touched = settleInterest(toAccount, now) || touched;
+        touched = foldIfShort(fromAccount, amount) || touched;
+        if (!creditAllowed(toAccount, amount)) {
+            return false;
+        }
+        Money fromBefore = fromAccount->getBalance();
+        Money toBefore = toAccount->getBalance();
+        if (!postTransfer(fromAccount, toAccount, amount)) {
+            return false;
+        }
+        velocity.recordDebit(fromAccNum, amount, now);
+        noteBalanceChange(fromAccount, fromBefore);
+        noteBalanceChange(toAccount, toBefore);
+        touched = true;
+        return true;
+    }
+
+    // The ledger entries of a transfer: a Withdrawal from one account, a Deposit to the other and
+    // a Transfer memo on both. Callers handle locking, velocity limits and the indexes.
+    static bool postTransfer(Account* fromAccount, Account* toAccount, Money amount) {
+        int fromAccNum = fromAccount->getAccountNumber();
+        int toAccNum = toAccount->getAccountNumber();
+        if (!fromAccount->withdraw(amount)) {
+            return false;
+        }
+        toAccount->deposit(amount);
+        Transaction transaction("Transfer", amount, fromAccNum, toAccNum);
+        fromAccount->addTransaction(transaction);
+        toAccount->addTransaction(transaction);
+        cout << "Transfer of $" << amount;
+        cout << " from account " << fromAccNum << " to account " << toAccNum;
+        cout << " completed successfully." << endl;
+        return true;
+    }
+
+    void displayAccount(int accountNumber) {
+        Account* account = findAccount(accountNumber);
+        if (account) {
+            lock_guard<mutex> guard(bookMutex);
+            bool folded = foldHotCredits(account);
+            if (settleInterest(account, currentTime()) || folded) {
+                publish(account);
+            }
+            account->display();
+        }
+        else {
+            cout << "Account " << accountNumber << " not found!" << endl;
+        }
+    }
+
+    void displayAccountTransactions(int accountNumber) {
+        Account* account = findAccount(accountNumber);
+        if (account) {
+            lock_guard<mutex> guard(bookMutex);
+            bool folded = foldHotCredits(account);
+            if (settleInterest(account, currentTime()) || folded) {
+                publish(account);
+            }
+            account->displayTransactions();
+        }
+        else {
+            cout << "Account " << accountNumber << " not found!" << endl;
+        }
+    }
+
+    // Folds every hot account's stripes so the next snapshot carries full balances
+    void foldAllHotCredits() {
+        lock_guard<mutex> guard(bookMutex);
+        vector<const Account*> changed;
+        for (Account* account : stripedAccounts) {
+            if (foldHotCredits(account)) {
+                changed.push_back(account);
+            }
+        }
+        if (!changed.empty()) {
+            snapshots.publishAccounts(changed.data(), static_cast<int>(changed.size()));
+        }
+    }
+
+    // Reads one published snapshot, so the listing is consistent and never holds up writers
+    void displayAllAccounts() {
+        foldAllHotCredits();
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        if (image->accountCount == 0) {
+            cout << "No accounts found in the system!" << endl;
+            return;
+        }
+        ReportWriter out(cout);
+        out.text("\n--- All Accounts ---\n");
+        renderAccountList(out, *image);
+    }
+
+    static void renderAccountList(ReportWriter& out, const BookImage& image) {
+        time_t now = currentTime();
+        displayAccountHeader(out);
+        for (int i = 0; i < image.accountCount; i++) {
+            displayAccountRow(out, image.account(i), now);
+        }
+    }
+
+    // The pre-snapshot way of reading the book: walks the live accounts under the writer lock
+    void renderLiveAccountList(ReportWriter& out) const {
+        lock_guard<mutex> guard(bookMutex);
+        displayAccountHeader(out);
+        for (int i = 0; i < accountCount; i++) {
+            displayAccountRow(out, accounts[i]);
+        }
+    }
+
+    shared_ptr<const BookImage> acquireSnapshot() const { return snapshots.acquire(); }
+
+    void displayBookSummary() {
+        foldAllHotCredits();
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        time_t now = currentTime();
+        Money savingsTotal, currentTotal, overdrawnTotal, loanTotal, unpostedInterest;
+        int savingsCount = 0, currentCount = 0, activeLoans = 0;
+        for (int i = 0; i < image->accountCount; i++) {
+            const AccountState& state = image->account(i);
+            if (state.accruesInterest()) {
+                Money interest = state.interestAsOf(now);
+                savingsTotal += state.balance + interest;
+                unpostedInterest += interest;
+                savingsCount++;
+            }
+            else {
+                currentTotal += state.balance;
+                currentCount++;
+            }
+            if (state.balance < Money()) {
+                overdrawnTotal -= state.balance;
+            }
+        }
+        for (const Loan& loan : *image->loans) {
+            if (loan.isActive()) {
+                loanTotal += loan.getRemainingBalance();
+                activeLoans++;
+            }
+        }
+        ReportWriter out(cout);
+        out.text("\n--- Book Summary (snapshot version ").integer(image->version).text(") ---\n");
+        out.text("Savings Accounts: ").integer(savingsCount).text(", total ").money(savingsTotal);
+        out.text(" (").money(unpostedInterest).text(" interest accrued, not yet posted)\n");
+        out.text("Current Accounts: ").integer(currentCount).text(", total ").money(currentTotal).newline();
+        out.text("Total Deposits: ").money(savingsTotal + currentTotal).newline();
+        out.text("Total Overdrawn: ").money(overdrawnTotal).newline();
+        out.text("Active Loans: ").integer(activeLoans).text(", outstanding ").money(loanTotal).newline();
+        out.text("Ledger Position: next transaction ").integer(image->nextTransactionID);
+        out.text(", next account ").integer(image->nextAccountNumber);
+        out.text(", next loan ").integer(image->nextLoanID).newline();
+    }
+
+    // Bulk export of every account as CSV or as the fixed-width listing. Written from a published
+    // snapshot like the save file, with savings balances including interest accrued but not posted.
+    void exportAccounts(const string& filename, bool csv) const {
+        ofstream outFile(filename, ios::binary);
+        if (!outFile) {
+            cerr << "Error opening file for writing!" << endl;
+            return;
+        }
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        time_t now = currentTime();
+        {
+            ReportWriter out(outFile);
+            if (csv) {
+                out.text("account_number,type,customer_id,customer_name,balance,transaction_count\n");
+                for (int i = 0; i < image->accountCount; i++) {
+                    const AccountState& state = image->account(i);
+                    out.integer(state.identity->accountNumber).character(',');
+                    out.csvField(state.identity->accountType).character(',');
+                    out.integer(state.identity->customerID).character(',');
+                    out.csvField(state.identity->customerName).character(',');
+                    out.money(state.balanceAsOf(now), false).character(',');
+                    out.integer(state.transactionCount).newline();
+                }
+            }
+            else {
+                displayAccountHeader(out);
+                for (int i = 0; i < image->accountCount; i++) {
+                    displayAccountRow(out, image->account(i), now);
+                }
+            }
+        }
+        outFile.close();
+        cout << "Exported " << image->accountCount << " account(s) to " << filename << endl;
+    }
+
+    // Bulk export of every recorded transaction, one row per account entry, from a published snapshot
+    void exportTransactions(const string& filename, bool csv) const {
+        ofstream outFile(filename, ios::binary);
+        if (!outFile) {
+            cerr << "Error opening file for writing!" << endl;
+            return;
+        }
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        long long rows = 0;
+        {
+            ReportWriter out(outFile);
+            if (csv) {
+                out.text("account_number,transaction_id,date_time,type,amount,from_account,to_account\n");
+            }
+            else {
+                out.column("Acc No.", 10).separator();
+                Account::displayTransactionHeader(out, 83);
+            }
+            for (int i = 0; i < image->accountCount; i++) {
+                const AccountState& state = image->account(i);
+                for (int j = 0; j < state.transactionCount; j++) {
+                    const Transaction& transaction = state.identity->account->getTransaction(j);
+                    if (csv) {
+                        out.integer(state.identity->accountNumber).character(',');
+                        transaction.writeCsv(out);
+                    }
+                    else {
+                        out.integerColumn(state.identity->accountNumber, 10).separator();
+                        transaction.display(out);
+                    }
+                    rows++;
+                }
+            }
+        }
+        outFile.close();
+        cout << "Exported " << rows << " transaction(s) to " << filename << endl;
+    }
+
+    // Writes every account's history from a published snapshot in the compact archive format
+    void archiveHistory(const string& filename) {
+        ofstream outFile(filename, ios::binary);
+        if (!outFile) {
+            cerr << "Error opening file for writing!" << endl;
+            return;
+        }
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        auto started = chrono::steady_clock::now();
+        HistoryArchiveWriter writer(outFile);
+        for (int i = 0; i < image->accountCount; i++) {
+            const AccountState& state = image->account(i);
+            for (int j = 0; j < state.transactionCount; j++) {
+                writer.add(state.identity->accountNumber, state.identity->account->getTransaction(j));
+            }
+        }
+        if (!writer.finish()) {
+            cerr << "Error writing archive " << filename << "!" << endl;
+            return;
+        }
+        double seconds = secondsSince(started);
+        cout << "Archived " << writer.getEntryCount() << " transaction(s) in " << writer.getBlockCount()
+            << " block(s) to " << filename << ": " << writer.getByteCount() << " bytes in "
+            << formatDouble(seconds * 1000) << " ms" << endl;
+    }
+
+    // Decodes an archive back into the same CSV layout as the transaction export
+    void expandArchive(const string& archive, const string& filename) const {
+        ifstream inFile(archive, ios::binary);
+        if (!inFile) {
+            cerr << "Error opening archive " << archive << "!" << endl;
+            return;
+        }
+        ofstream outFile(filename, ios::binary);
+        if (!outFile) {
+            cerr << "Error opening file for writing!" << endl;
+            return;
+        }
+        HistoryArchiveReader reader(inFile);
+        vector<ArchivedTransaction> entries;
+        long long rows = 0;
+        {
+            ReportWriter out(outFile);
+            out.text("account_number,transaction_id,date_time,type,amount,from_account,to_account\n");
+            while (reader.nextBlock(entries)) {
+                for (const ArchivedTransaction& entry : entries) {
+                    out.integer(entry.accountNumber).character(',');
+                    entry.toTransaction().writeCsv(out);
+                }
+                rows += static_cast<long long>(entries.size());
+            }
+        }
+        outFile.close();
+        if (!reader.getError().empty()) {
+            cerr << archive << ": " << reader.getError() << "; " << rows << " transaction(s) before it were written to "
+                << filename << endl;
+            return;
+        }
+        cout << "Expanded " << rows << " transaction(s) from " << reader.getBlockCount() << " block(s) of "
+            << archive << " to " << filename << endl;
+    }
+
+    void generateStatements() {
+        if (accountCount == 0) {
+            cout << "No accounts found in the system!" << endl;
+            return;
+        }
+        int year, month, mode, threads;
+        cout << "Enter statement year (e.g. 2024): ";
+        year = getIntInput();
+        cout << "Enter statement month (1-12): ";
+        month = getIntInput();
+        if (year < 1970 || month < 1 || month > 12) {
+            cout << "Invalid statement period!" << endl;
+            return;
+        }
+        cout << "1. One file per account" << endl;
+        cout << "2. Sharded bundle (one file per worker)" << endl;
+        cout << "Enter output mode (1-2): ";
+        mode = getIntInput();
+        if (mode != 1 && mode != 2) {
+            cout << "Invalid choice!" << endl;
+            return;
+        }
+        cout << "Enter number of worker threads (0 = all cores): ";
+        threads = getIntInput();
+        string outputDir;
+        cout << "Enter output directory: ";
+        clearInputBuffer();
+        getline(cin, outputDir);
+        if (outputDir.empty()) {
+            outputDir = "statements";
+        }
+        // Statements are a posting point for lazily accrued interest
+        foldAllHotCredits();
+        postAllAccruedInterest();
+        vector<const Account*> snapshot(accounts, accounts + accountCount);
+        StatementJob job(bankName, year, month, outputDir, mode == 2);
+        StatementRunStats stats;
+        if (!job.run(snapshot, threads, stats)) {
+            return;
+        }
+        cout << "Generated " << stats.statements << " statement(s) covering " << stats.transactions
+            << " transaction(s) in " << formatDouble(stats.seconds * 1000.0) << " ms using "
+            << stats.threads << " thread(s)." << endl;
+        cout << "Throughput: " << formatDouble(stats.statementsPerSecond()) << " statements/sec" << endl;
+    }
+
+    // Registers a standing order (intervalSeconds > 0) or a one-off future-dated transfer. The
+    // accounts are checked now; funds and velocity limits are checked each time it runs.
+    int scheduleTransfer(int fromAccNum, int toAccNum, Money amount, time_t firstDue, long long intervalSeconds) {
+        time_t when = currentTime();
+        int orderID = addStandingOrder(fromAccNum, toAccNum, amount, firstDue, intervalSeconds);
+        if (recorder) {
+            TraceRecord record;
+            record.op = TRACE_SCHEDULE;
+            record.applied = orderID > 0;
+            record.when = when;
+            record.account = fromAccNum;
+            record.other = toAccNum;
+            record.amount = amount;
+            record.due = static_cast<long long>(firstDue);
+            record.period = intervalSeconds;
+            capture(record);
+        }
+        return orderID;
+    }
+
+    int addStandingOrder(int fromAccNum, int toAccNum, Money amount, time_t firstDue, long long intervalSeconds) {
+        if (fromAccNum == toAccNum) {
+            cout << "Cannot transfer to the same account!" << endl;
+            return 0;
+        }
+        if (amount <= Money() || intervalSeconds < 0) {
+            cout << "Invalid standing order!" << endl;
+            return 0;
+        }
+        lock_guard<mutex> guard(bookMutex);
+        if (!findAccount(fromAccNum) || !findAccount(toAccNum)) {
+            cout << "Account not found!" << endl;
+            return 0;
+        }
+        StandingOrder order;
+        order.fromAccount = fromAccNum;
+        order.toAccount = toAccNum;
+        order.amount = amount;
+        order.nextDue = firstDue;
+        order.intervalSeconds = intervalSeconds;
+        int orderID = scheduler.add(order);
+        publishStandingOrders();
+        return orderID;
+    }
+
+    bool cancelStandingOrder(int orderID) {
+        lock_guard<mutex> guard(bookMutex);
+        bool cancelled = scheduler.cancel(orderID);
+        capture(TRACE_CANCEL_ORDER, orderID, 0, Money(), cancelled, currentTime());
+        if (!cancelled) {
+            return false;
+        }
+        publishStandingOrders();
+        return true;
+    }
+
+    // Runs every standing order due by now as one batch under a single lock, with one publish at the
+    // end. Orders whose accounts have been closed are cancelled; refused transfers keep their schedule.
+    int runDueTransfers(time_t now) {
+        lock_guard<mutex> guard(bookMutex);
+        auto started = chrono::steady_clock::now();
+        dueOrders.clear();
+        scheduler.takeDue(now, dueOrders);
+        if (dueOrders.empty()) {
+            return 0;
+        }
+        vector<const Account*> changed;
+        long long executed = 0, failed = 0;
+        for (const StandingOrder& order : dueOrders) {
+            Account* fromAccount = findAccount(order.fromAccount);
+            Account* toAccount = findAccount(order.toAccount);
+            if (!fromAccount || !toAccount) {
+                scheduler.cancel(order.orderID);
+                cout << "Standing order " << order.orderID << " cancelled: account no longer exists." << endl;
+                failed++;
+                continue;
+            }
+            bool touched = false;
+            if (applyTransfer(fromAccount, toAccount, order.amount, now, touched)) {
+                executed++;
+            }
+            else {
+                failed++;
+            }
+            if (touched) {
+                changed.push_back(fromAccount);
+                changed.push_back(toAccount);
+            }
+        }
+        if (!changed.empty()) {
+            snapshots.publishAccounts(changed.data(), static_cast<int>(changed.size()));
+        }
+        publishStandingOrders();
+        scheduler.recordBatch(executed, failed, secondsSince(started));
+        capture(TRACE_RUN_DUE, 0, 0, Money(), executed > 0, now);
+        return static_cast<int>(executed);
+    }
+
+    const TransferScheduler& getScheduler() const { return scheduler; }
+
+    void displaySchedulerStats() const {
+        const SchedulerStats& stats = scheduler.getStats();
+        cout << "\n--- Standing Orders ---" << endl;
+        cout << "Pending Orders: " << scheduler.size() << endl;
+        cout << "Fired: " << stats.fired << " in " << stats.batches << " batch(es); executed " << stats.executed
+            << ", refused " << stats.failed << ", missed while offline " << stats.missed << endl;
+        cout << "Lag: average " << formatDouble(stats.averageLagSeconds()) << " s, max "
+            << formatDouble(stats.maxLagSeconds) << " s" << endl;
+        cout << "Firing Throughput: " << formatDouble(stats.firedPerSecond()) << " orders/sec" << endl;
+    }
+
+    void manageStandingOrders() {
+        int choice;
+        cout << "\n--- Standing Orders ---" << endl;
+        cout << "1. Schedule a Transfer" << endl;
+        cout << "2. List Standing Orders" << endl;
+        cout << "3. Cancel a Standing Order" << endl;
+        cout << "4. Run Due Orders Now" << endl;
+        cout << "5. Scheduler Statistics" << endl;
+        cout << "6. Back to Main Menu" << endl;
+        cout << "Enter choice (1-6): ";
+        choice = getIntInput();
+        if (choice == 1) {
+            int fromAccNum, toAccNum, delayDays, repeatDays;
+            Money amount;
+            cout << "Enter source account number: ";
+            fromAccNum = getIntInput();
+            if (!findAccount(fromAccNum)) {
+                cout << "Source account " << fromAccNum << " not found!" << endl;
+                return;
+            }
+            string pin = getPinInput();
+            if (!verifyCustomerPin(fromAccNum, pin)) {
+                return;
+            }
+            cout << "Enter destination account number: ";
+            toAccNum = getIntInput();
+            cout << "Enter transfer amount: $";
+            amount = getMoneyInput();
+            cout << "Enter days until the first transfer (0 = today): ";
+            delayDays = getIntInput();
+            cout << "Repeat every how many days? (0 = once): ";
+            repeatDays = getIntInput();
+            if (delayDays < 0 || repeatDays < 0) {
+                cout << "Days cannot be negative!" << endl;
+                return;
+            }
+            const long long day = SavingsAccount::SECONDS_PER_DAY;
+            int orderID = scheduleTransfer(fromAccNum, toAccNum, amount,
+                currentTime() + static_cast<time_t>(delayDays * day), repeatDays * day);
+            if (orderID > 0) {
+                cout << "Standing order " << orderID << " scheduled." << endl;
+            }
+        }
+        else if (choice == 2) {
+            shared_ptr<const BookImage> image = snapshots.acquire();
+            if (image->standingOrders->empty()) {
+                cout << "No standing orders scheduled." << endl;
+                return;
+            }
+            ReportWriter out(cout);
+            out.column("Order", 7).separator().column("From", 6).separator().column("To", 6).separator();
+            out.column("Amount", 12).separator().column("Next Due", 20).separator().text("Repeats\n");
+            out.line(75);
+            for (const StandingOrder& order : *image->standingOrders) {
+                out.integerColumn(order.orderID, 7).separator().integerColumn(order.fromAccount, 6).separator();
+                out.integerColumn(order.toAccount, 6).separator().moneyColumn(order.amount, 12).separator();
+                out.column(formatDateTime(order.nextDue), 20).separator();
+                if (order.intervalSeconds > 0) {
+                    out.text("every ").number(order.intervalSeconds / double(SavingsAccount::SECONDS_PER_DAY)).text(" day(s)\n");
+                }
+                else {
+                    out.text("once\n");
+                }
+            }
+        }
+        else if (choice == 3) {
+            int orderID;
+            cout << "Enter order ID: ";
+            orderID = getIntInput();
+            int fromAccNum;
+            {
+                lock_guard<mutex> guard(bookMutex);
+                const StandingOrder* order = scheduler.find(orderID);
+                if (!order) {
+                    cout << "Standing order " << orderID << " not found!" << endl;
+                    return;
+                }
+                fromAccNum = order->fromAccount;
+            }
+            string pin = getPinInput();
+            if (!verifyCustomerPin(fromAccNum, pin)) {
+                return;
+            }
+            if (cancelStandingOrder(orderID)) {
+                cout << "Standing order " << orderID << " cancelled." << endl;
+            }
+        }
+        else if (choice == 4) {
+            int executed = runDueTransfers(currentTime());
+            cout << executed << " standing order(s) executed." << endl;
+        }
+        else if (choice == 5) {
+            displaySchedulerStats();
+        }
+        else if (choice != 6) {
+            cout << "Invalid choice!" << endl;
+        }
+    }
+
+    // Marks an account hot (deposits go to per-thread stripes) or back to normal. Returns false when
+    // the account does not exist.
+    bool setAccountHot(int accountNumber, bool makeHot, int stripes) {
+        lock_guard<mutex> guard(bookMutex);
+        Account* account = findAccount(accountNumber);
+        capture(makeHot ? TRACE_HOT_ON : TRACE_HOT_OFF, accountNumber, stripes, Money(), account != nullptr, currentTime());
+        if (!account) {
+            return false;
+        }
+        if (makeHot) {
+            if (!account->getCreditStripes()) {
+                stripedAccounts.push_back(account);
+            }
+            account->makeHot(stripes > 0 ? stripes : max(1, static_cast<int>(thread::hardware_concurrency())));
+        }
+        else {
+            account->makeCold();
+            if (foldHotCredits(account)) {
+                publish(account);
+            }
+        }
+        return true;
+    }
+
+    void configureHotAccounts() {
+        int choice;
+        cout << "\n--- Hot Accounts ---" << endl;
+        {
+            lock_guard<mutex> guard(bookMutex);
+            for (const Account* account : stripedAccounts) {
+                SplitBalance* stripes = account->getCreditStripes();
+                cout << "Account " << account->getAccountNumber() << ": " << (account->isHot() ? "hot" : "normal")
+                    << ", " << stripes->getStripeCount() << " stripe(s), $" << stripes->pending() << " not yet folded" << endl;
+            }
+            if (stripedAccounts.empty()) {
+                cout << "No hot accounts." << endl;
+            }
+        }
+        cout << "\n1. Mark Account Hot" << endl;
+        cout << "2. Return Account to Normal" << endl;
+        cout << "3. Fold Hot Balances Now" << endl;
+        cout << "4. Back to Main Menu" << endl;
+        cout << "Enter choice (1-4): ";
+        choice = getIntInput();
+        if (choice == 1 || choice == 2) {
+            int accountNumber, stripes = 0;
+            cout << "Enter account number: ";
+            accountNumber = getIntInput();
+            if (choice == 1) {
+                cout << "Enter number of sub-balances (0 = one per core): ";
+                stripes = getIntInput();
+            }
+            if (!setAccountHot(accountNumber, choice == 1, stripes)) {
+                cout << "Account " << accountNumber << " not found!" << endl;
+                return;
+            }
+            cout << "Account " << accountNumber << (choice == 1 ? " is now hot." : " is back to a single balance.") << endl;
+        }
+        else if (choice == 3) {
+            foldAllHotCredits();
+            cout << "Hot balances folded." << endl;
+        }
+        else if (choice != 4) {
+            cout << "Invalid choice!" << endl;
+        }
+    }
+
+    VelocityEngine& getVelocityEngine() { return velocity; }
+
+    // Account number 0 sets the default rule
+    void setVelocityRule(int accountNumber, const VelocityRule& rule) {
+        lock_guard<mutex> guard(bookMutex);
+        if (accountNumber == 0) {
+            velocity.setDefaultRule(rule);
+        }
+        else {
+            velocity.setAccountRule(accountNumber, rule);
+        }
+        captureVelocityRule(accountNumber, rule, currentTime());
+    }
+
+    void clearVelocityRule(int accountNumber) {
+        lock_guard<mutex> guard(bookMutex);
+        velocity.clearAccountRule(accountNumber);
+        capture(TRACE_VELOCITY_CLEAR, accountNumber, 0, Money(), true, currentTime());
+    }
+
+    void configureVelocityLimits() {
+        int choice;
+        velocity.displayStats();
+        cout << "\n1. Set Default Rule" << endl;
+        cout << "2. Set Rule for One Account" << endl;
+        cout << "3. Remove Rule for One Account" << endl;
+        cout << "4. Back to Main Menu" << endl;
+        cout << "Enter choice (1-4): ";
+        choice = getIntInput();
+        if (choice == 4) {
+            return;
+        }
+        if (choice < 1 || choice > 4) {
+            cout << "Invalid choice!" << endl;
+            return;
+        }
+        int accountNumber = 0;
+        if (choice == 2 || choice == 3) {
+            cout << "Enter account number: ";
+            accountNumber = getIntInput();
+            if (!findAccount(accountNumber)) {
+                cout << "Account " << accountNumber << " not found!" << endl;
+                return;
+            }
+        }
+        if (choice == 3) {
+            clearVelocityRule(accountNumber);
+            cout << "Velocity rule removed for account " << accountNumber << "." << endl;
+            return;
+        }
+        VelocityRule rule;
+        cout << "Enter maximum withdrawals/transfers per window (0 = no cap): ";
+        rule.maxOperations = getIntInput();
+        cout << "Enter maximum amount out per window (0 = no cap): $";
+        rule.maxAmount = getMoneyInput();
+        cout << "Enter window length in seconds: ";
+        rule.windowSeconds = getIntInput();
+        if (rule.maxOperations < 0 || rule.maxAmount < Money() || rule.windowSeconds <= 0) {
+            cout << "Invalid velocity rule!" << endl;
+            return;
+        }
+        // A window with no divisor near BUCKETS (say a prime over 60) would get a few wide buckets,
+        // letting debits age out well before the window ends
+        if (VelocityWindow::bucketsFor(rule.windowSeconds) < min(rule.windowSeconds, VelocityWindow::BUCKETS / 6)) {
+            cout << "Window cannot be split into even buckets; try a whole number of minutes." << endl;
+            return;
+        }
+        if (choice == 1) {
+            setVelocityRule(0, rule);
+            cout << "Default velocity rule updated." << endl;
+        }
+        else {
+            setVelocityRule(accountNumber, rule);
+            cout << "Velocity rule set for account " << accountNumber << "." << endl;
+        }
+    }
+
+    void displayStats() const {
+        cout << "\n=== System Statistics ===" << endl;
+        cout << "Accounts: " << accountCount << " / " << MAX_ACCOUNTS << endl;
+        cout << "Loans: " << loanCount << " / " << MAX_LOANS << endl;
+        velocity.displayStats();
+        cout << "\n--- Balance Journal ---" << endl;
+        cout << "Journal Entries: " << journal.getEntryCount() << " (" << journal.journalBytes() << " bytes)" << endl;
+        cout << "Checkpoints: " << journal.getCheckpointCount() << " (" << journal.checkpointBytes() << " bytes)" << endl;
+        cout << "Checkpoint Interval: every " << journal.getCheckpointInterval() << " entries" << endl;
+        checkpointer.displayStats();
+        displaySchedulerStats();
+        displaySessionStats();
+        displayMemoryReport();
+    }
+
+    // Footprint of every subsystem, in display order. unusedHistoryBytes is the part of the history
+    // bytes held by transaction slots no account has filled yet.
+    vector<MemoryUsage> memoryReport(long long& unusedHistoryBytes) const {
+        lock_guard<mutex> guard(bookMutex);
+        MemoryUsage accountUsage{ "Accounts", accountCount, static_cast<long long>(sizeof(accounts)) };
+        MemoryUsage customerUsage{ "Customers", accountCount, 0 };
+        MemoryUsage historyUsage{ "Transaction history", 0, 0 };
+        const size_t historyBytes = MAX_TRANSACTIONS * sizeof(Transaction);
+        unusedHistoryBytes = 0;
+        for (int i = 0; i < accountCount; i++) {
+            const Account* account = accounts[i];
+            accountUsage.bytes += static_cast<long long>(account->objectBytes() - sizeof(Customer) - historyBytes);
+            customerUsage.bytes += static_cast<long long>(sizeof(Customer) + account->getCustomer().heapBytes());
+            historyUsage.objects += account->getTransactionCount();
+            historyUsage.bytes += static_cast<long long>(historyBytes + account->historyHeapBytes());
+            unusedHistoryBytes += static_cast<long long>((MAX_TRANSACTIONS - account->getTransactionCount()) * sizeof(Transaction));
+        }
+        vector<MemoryUsage> report = { accountUsage, customerUsage, historyUsage };
+        MemoryUsage stripeUsage{ "Hot account stripes", static_cast<long long>(stripedAccounts.size()),
+            static_cast<long long>(stripedAccounts.capacity() * sizeof(Account*)) };
+        for (const Account* account : stripedAccounts) {
+            stripeUsage.bytes += static_cast<long long>(account->getCreditStripes()->memoryBytes());
+        }
+        report.push_back(stripeUsage);
+        MemoryUsage loanUsage{ "Loans", loanCount, static_cast<long long>(sizeof(loans)) };
+        for (int i = 0; i < loanCount; i++) {
+            if (loans[i]) {
+                loanUsage.bytes += static_cast<long long>(sizeof(Loan));
+            }
+        }
+        report.push_back(loanUsage);
+        report.push_back(accountIndex.memoryUsage());
+        report.push_back(velocity.memoryUsage());
+        report.push_back(journal.memoryUsage());
+        report.push_back(snapshots.memoryUsage());
+        MemoryUsage orders = scheduler.memoryUsage();
+        orders.bytes += static_cast<long long>(dueOrders.capacity() * sizeof(StandingOrder));
+        report.push_back(orders);
+        MemoryUsage sessionUsage = sessions.memoryUsage();
+        sessionUsage.bytes += static_cast<long long>(hashTableBytes(batchSessions) + stringHeapBytes(terminalSession));
+        report.push_back(sessionUsage);
+        report.push_back(MemoryUsage{ "Interest run set", static_cast<long long>(touchedSavings.size()),
+            static_cast<long long>(hashTableBytes(touchedSavings)) });
+        return report;
+    }
+
+    void displayMemoryReport() const {
+        long long unusedHistoryBytes = 0;
+        vector<MemoryUsage> report = memoryReport(unusedHistoryBytes);
+        long long total = 0, historyBytes = 0;
+        for (const MemoryUsage& usage : report) {
+            total += usage.bytes;
+            if (usage.subsystem == "Transaction history") {
+                historyBytes = usage.bytes;
+            }
+        }
+        ReportWriter out(cout);
+        out.text("\n--- Memory Footprint ---\n");
+        out.column("Subsystem", 22).separator().column("Objects", 10).separator().column("Bytes", 12).separator();
+        out.column("Share", 6).newline();
+        out.line(60);
+        for (const MemoryUsage& usage : report) {
+            out.column(usage.subsystem, 22).separator().integerColumn(usage.objects, 10).separator();
+            out.integerColumn(usage.bytes, 12).separator();
+            out.text(formatDouble(total > 0 ? 100.0 * usage.bytes / total : 0.0)).text("%").newline();
+        }
+        out.line(60);
+        out.column("Total", 22).separator().spaces(10).separator().integerColumn(total, 12).newline();
+        if (accountCount > 0) {
+            out.text("Per account: ").integer(total / accountCount).text(" bytes\n");
+        }
+        if (historyBytes > 0) {
+            out.text("Unused inline transaction slots: ").integer(unusedHistoryBytes).text(" bytes (");
+            out.text(formatDouble(100.0 * unusedHistoryBytes / historyBytes)).text("% of transaction history)\n");
+        }
+    }
+
+    void displaySessionStats() const {
+        lock_guard<mutex> guard(bookMutex);
+        const SessionStats& stats = sessions.getStats();
+        cout << "\n--- Sessions ---" << endl;
+        cout << "Active Sessions: " << sessions.size() << " (idle timeout " << sessions.getTimeout() << " s)" << endl;
+        cout << "Opened: " << stats.opened << ", closed " << stats.closed << ", expired " << stats.expired << endl;
+        cout << "Operations on a Session: " << stats.validated << ", refused " << stats.rejected << endl;
+    }
+
+    void manageSessions() {
+        int choice;
+        {
+            lock_guard<mutex> guard(bookMutex);
+            const Session* session = sessions.find(terminalSession);
+            if (session && session->expires > currentTime()) {
+                cout << "\nSigned in to account " << session->accountNumber << ", " << session->uses
+                    << " operation(s) so far, expires at " << formatDateTime(session->expires) << endl;
+            }
+            else {
+                cout << "\nNot signed in." << endl;
+            }
+        }
+        displaySessionStats();
+        cout << "\n1. Sign In" << endl;
+        cout << "2. Sign Out" << endl;
+        cout << "3. Set Idle Timeout" << endl;
+        cout << "4. Back to Main Menu" << endl;
+        cout << "Enter choice (1-4): ";
+        choice = getIntInput();
+        if (choice == 1) {
+            int accountNumber;
+            cout << "Enter account number: ";
+            accountNumber = getIntInput();
+            if (!findAccount(accountNumber)) {
+                cout << "Account " << accountNumber << " not found!" << endl;
+                return;
+            }
+            string previous = terminalSession;
+            terminalSession.clear();
+            if (!authenticate(accountNumber)) {
+                terminalSession = previous;
+            }
+            else if (!previous.empty()) {
+                signOut(previous);
+            }
+        }
+        else if (choice == 2) {
+            if (!terminalSession.empty() && signOut(terminalSession)) {
+                cout << "Signed out." << endl;
+            }
+            else {
+                cout << "Not signed in." << endl;
+            }
+            terminalSession.clear();
+        }
+        else if (choice == 3) {
+            cout << "Enter idle timeout in seconds: ";
+            int seconds = getIntInput();
+            if (seconds <= 0) {
+                cout << "Timeout must be positive!" << endl;
+                return;
+            }
+            lock_guard<mutex> guard(bookMutex);
+            sessions.setTimeout(seconds);
+            cout << "Sessions now expire after " << seconds << " seconds without use." << endl;
+        }
+        else if (choice != 4) {
+            cout << "Invalid choice!" << endl;
+        }
+    }
+
+    BackgroundCheckpointer& getCheckpointer() { return checkpointer; }
+
+    // Reconciles the current snapshot, so writers carry on while it runs
+    void reconcileBooks() {
+        foldAllHotCredits();
+        int threads;
+        cout << "Enter number of worker threads (0 = all cores): ";
+        threads = getIntInput();
+        string filename;
+        cout << "Enter report filename: ";
+        clearInputBuffer();
+        getline(cin, filename);
+        if (filename.empty()) {
+            filename = "reconciliation_report.txt";
+        }
+        ofstream outFile(filename, ios::binary);
+        if (!outFile) {
+            cerr << "Error opening " << filename << " for writing!" << endl;
+            return;
+        }
+        ReconciliationStats stats;
+        {
+            ReportWriter out(outFile);
+            Reconciler(threads).run(*snapshots.acquire(), out, stats);
+        }
+        outFile.close();
+        cout << "Reconciled " << stats.accounts << " account(s), " << stats.transactions << " transaction(s), "
+            << stats.transfers << " transfer(s) and " << stats.loans << " loan(s) in "
+            << formatDouble(stats.seconds * 1000.0) << " ms using " << stats.threads << " thread(s)." << endl;
+        cout << "Breaks: " << stats.balanceBreaks << " balance, " << stats.transferBreaks << " transfer, "
+            << stats.loanBreaks << " loan; " << stats.unverified << " unverified. Report written to " << filename << endl;
+    }
+
+    void configureCheckpointing() {
+        int choice;
+        checkpointer.displayStats();
+        cout << "\n1. Start / Change Schedule" << endl;
+        cout << "2. Stop" << endl;
+        cout << "3. Checkpoint Now" << endl;
+        cout << "4. Back to Main Menu" << endl;
+        cout << "Enter choice (1-4): ";
+        choice = getIntInput();
+        if (choice == 1) {
+            cout << "Enter checkpoint interval in seconds: ";
+            int seconds = getIntInput();
+            if (seconds <= 0) {
+                cout << "Interval must be positive!" << endl;
+                return;
+            }
+            string filename;
+            cout << "Enter checkpoint filename: ";
+            clearInputBuffer();
+            getline(cin, filename);
+            if (filename.empty()) {
+                cout << "Filename cannot be empty!" << endl;
+                return;
+            }
+            checkpointer.start(filename, seconds * 1000);
+            cout << "Background checkpoints every " << seconds << " s to " << filename << "." << endl;
+        }
+        else if (choice == 2) {
+            checkpointer.stop();
+            cout << "Background checkpointing stopped." << endl;
+        }
+        else if (choice == 3) {
+            if (!checkpointer.isRunning()) {
+                cout << "Start the checkpointer first!" << endl;
+                return;
+            }
+            checkpointer.requestCheckpoint();
+            cout << "Checkpoint requested." << endl;
+        }
+        else if (choice != 4) {
+            cout << "Invalid choice!" << endl;
+        }
+    }
+
+    BalanceJournal& getJournal() { return journal; }
+
+    void pointInTimeBalances() {
+        int choice;
+        cout << "\n--- Point-in-Time Balances ---" << endl;
+        cout << "1. Balance of One Account as of a Date" << endl;
+        cout << "2. Entire Book as of a Date" << endl;
+        cout << "3. Set Checkpoint Interval" << endl;
+        cout << "4. Back to Main Menu" << endl;
+        cout << "Enter choice (1-4): ";
+        choice = getIntInput();
+        if (choice == 4) {
+            return;
+        }
+        if (choice == 3) {
+            cout << "Current interval: every " << journal.getCheckpointInterval() << " entries" << endl;
+            cout << "Enter new checkpoint interval (entries): ";
+            int interval = getIntInput();
+            if (interval <= 0) {
+                cout << "Interval must be positive!" << endl;
+                return;
+            }
+            journal.setCheckpointInterval(interval);
+            cout << "Checkpoint interval set to " << interval << " entries." << endl;
+            return;
+        }
+        if (choice != 1 && choice != 2) {
+            cout << "Invalid choice!" << endl;
+            return;
+        }
+        int accountNumber = 0;
+        if (choice == 1) {
+            cout << "Enter account number: ";
+            accountNumber = getIntInput();
+        }
+        string when;
+        cout << "Enter date/time (YYYY-MM-DD or YYYY-MM-DD HH:MM:SS): ";
+        clearInputBuffer();
+        getline(cin, when);
+        time_t asOf;
+        if (!parseDateTime(when, asOf)) {
+            cout << "Invalid date/time format!" << endl;
+            return;
+        }
+        auto started = chrono::steady_clock::now();
+        if (choice == 1) {
+            Money balance;
+            bool found = journal.balanceAsOf(accountNumber, asOf, balance);
+            double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+            if (!found) {
+                cout << "Account " << accountNumber << " had no recorded balance at " << when << "." << endl;
+                return;
+            }
+            cout << "Balance of account " << accountNumber << " as of " << when << ": $" << balance
+                << " (" << formatDouble(micros) << " us)" << endl;
+            return;
+        }
+        vector<AccountBalance> book;
+        if (!journal.bookAsOf(asOf, book)) {
+            cout << "No recorded history before " << when << "." << endl;
+            return;
+        }
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+        ReportWriter out(cout);
+        out.text("\n--- Book as of ").text(when).text(" ---\n");
+        out.column("Acc No.", 10).separator().column("Balance", 12).newline();
+        out.line(25);
+        Money total;
+        for (const AccountBalance& entry : book) {
+            out.integerColumn(entry.accountNumber, 10).separator().moneyColumn(entry.balance, 12).newline();
+            total += entry.balance;
+        }
+        out.line(25);
+        out.text("Total: ").money(total).text(" across ").integer(static_cast<long long>(book.size()));
+        out.text(" account(s), rebuilt in ").text(formatDouble(micros)).text(" us\n");
+    }
+
+    // Runs one command per line: open, login, logout, deposit, withdraw, transfer, schedule, run-due,
+    // interest, hot, close, save, capture-start, capture-stop. After 'login <account> <pin>', a '*' in place of that account's PIN runs
+    // the command on the session instead. Blank lines and lines starting with '#' are skipped; bad
+    // lines are reported and skipped. Sessions the file opened end with it.
+    void runBatchFile(const string& filename, bool quiet) {
+        ifstream inFile(filename, ios::binary);
+        if (!inFile) {
+            cerr << "Error opening batch file " << filename << "!" << endl;
+            return;
+        }
+        const int maxReportedErrors = 20;
+        InputScanner in(inFile);
+        long long commands = 0, succeeded = 0, rejected = 0, malformed = 0;
+        auto started = chrono::steady_clock::now();
+        {
+            unique_ptr<QuietOutput> silence(quiet ? new QuietOutput() : nullptr);
+            string_view line;
+            string_view fields[8];
+            while (in.nextLine(line)) {
+                int count = InputScanner::splitFields(line, fields, 8);
+                if (count == 0 || fields[0][0] == '#') {
+                    continue;
+                }
+                commands++;
+                string error;
+                int result = runBatchCommand(line, fields, count, error);
+                if (result > 0) {
+                    succeeded++;
+                }
+                else if (result == 0) {
+                    rejected++;
+                }
+                else {
+                    malformed++;
+                    if (malformed <= maxReportedErrors) {
+                        cerr << filename << ": line " << in.getLineNumber() << ": " << error << endl;
+                    }
+                }
+            }
+        }
+        for (const auto& entry : batchSessions) {
+            signOut(entry.second);
+        }
+        batchSessions.clear();
+        double seconds = secondsSince(started);
+        if (malformed > maxReportedErrors) {
+            cerr << "... " << malformed - maxReportedErrors << " more malformed line(s) not shown" << endl;
+        }
+        cout << "Batch " << filename << ": " << commands << " command(s), " << succeeded << " succeeded, "
+            << rejected << " rejected, " << malformed << " malformed, in " << formatDouble(seconds * 1000.0) << " ms";
+        if (seconds > 0) {
+            cout << " (" << formatDouble(commands / seconds) << " commands/sec)";
+        }
+        cout << endl;
+    }
+
+    // '*' stands for the session this batch run signed in to the account with
+    string batchCredential(int accountNumber, string_view field) const {
+        if (field != "*") {
+            return string(field);
+        }
+        auto found = batchSessions.find(accountNumber);
+        return found == batchSessions.end() ? string() : found->second;
+    }
+
+    // 1 = applied, 0 = refused by the bank's rules, -1 = malformed (error says which field)
+    int runBatchCommand(string_view line, const string_view* fields, int count, string& error) {
+        string command = toLowerCopy(string(fields[0]));
+        int accountNumber = 0, otherAccount = 0;
+        Money amount;
+        auto needFields = [&](int expected, const char* usage) {
+            if (count != expected) {
+                error = "expected '" + string(usage) + "'";
+                return false;
+            }
+            return true;
+        };
+        auto parseAccount = [&](string_view text, int& value, const char* field) {
+            if (!InputScanner::parseInt(text, value)) {
+                error = "field '" + string(field) + "': expected an account number, found \"" + string(text) + "\"";
+                return false;
+            }
+            return true;
+        };
+        auto parseAmount = [&](string_view text, Money& value) {
+            if (!Money::parse(text, value)) {
+                error = "field 'amount': expected a number, found \"" + string(text) + "\"";
+                return false;
+            }
+            return true;
+        };
+        if (command == "deposit" || command == "withdraw") {
+            if (!needFields(4, "deposit|withdraw <account> <amount> <pin>") || !parseAccount(fields[1], accountNumber, "account")
+                || !parseAmount(fields[2], amount)) {
+                return -1;
+            }
+            Account* account = findAccount(accountNumber);
+            if (!account || !authorize(accountNumber, batchCredential(accountNumber, fields[3]))) {
+                return 0;
+            }
+            time_t when = currentTime();
+            bool applied = command == "deposit" ? executeDeposit(account, amount) : executeWithdrawal(account, amount);
+            capture(command == "deposit" ? TRACE_DEPOSIT : TRACE_WITHDRAWAL, accountNumber, 0, amount, applied, when);
+            return applied ? 1 : 0;
+        }
+        if (command == "transfer") {
+            if (!needFields(5, "transfer <from> <to> <amount> <pin>") || !parseAccount(fields[1], accountNumber, "from")
+                || !parseAccount(fields[2], otherAccount, "to") || !parseAmount(fields[3], amount)) {
+                return -1;
+            }
+            Account* fromAccount = findAccount(accountNumber);
+            Account* toAccount = findAccount(otherAccount);
+            if (!fromAccount || !toAccount || !authorize(accountNumber, batchCredential(accountNumber, fields[4]))) {
+                return 0;
+            }
+            time_t when = currentTime();
+            bool applied = executeTransfer(fromAccount, toAccount, amount);
+            capture(TRACE_TRANSFER, accountNumber, otherAccount, amount, applied, when);
+            return applied ? 1 : 0;
+        }
+        if (command == "schedule") {
+            long long delaySeconds = 0, intervalSeconds = 0;
+            if (!needFields(7, "schedule <from> <to> <amount> <pin> <first-due-in-seconds> <repeat-seconds>")
+                || !parseAccount(fields[1], accountNumber, "from") || !parseAccount(fields[2], otherAccount, "to")
+                || !parseAmount(fields[3], amount)) {
+                return -1;
+            }
+            if (!InputScanner::parseLongLong(fields[5], delaySeconds) || !InputScanner::parseLongLong(fields[6], intervalSeconds)) {
+                error = "fields 'first-due-in-seconds' and 'repeat-seconds': expected whole numbers of seconds";
+                return -1;
+            }
+            if (!findAccount(accountNumber) || !authorize(accountNumber, batchCredential(accountNumber, fields[4]))) {
+                return 0;
+            }
+            return scheduleTransfer(accountNumber, otherAccount, amount, currentTime() + static_cast<time_t>(delaySeconds),
+                intervalSeconds) > 0 ? 1 : 0;
+        }
+        if (command == "login") {
+            if (!needFields(3, "login <account> <pin>") || !parseAccount(fields[1], accountNumber, "account")) {
+                return -1;
+            }
+            string token = signIn(accountNumber, string(fields[2]));
+            if (token.empty()) {
+                return 0;
+            }
+            string& current = batchSessions[accountNumber];
+            if (!current.empty()) {
+                signOut(current);
+            }
+            current = token;
+            return 1;
+        }
+        if (command == "logout") {
+            if (!needFields(2, "logout <account>") || !parseAccount(fields[1], accountNumber, "account")) {
+                return -1;
+            }
+            auto found = batchSessions.find(accountNumber);
+            if (found == batchSessions.end()) {
+                return 0;
+            }
+            signOut(found->second);
+            batchSessions.erase(found);
+            return 1;
+        }
+        if (command == "run-due") {
+            if (!needFields(1, "run-due")) {
+                return -1;
+            }
+            runDueTransfers(currentTime());
+            return 1;
+        }
+        if (command == "open") {
+            if (count < 5) {
+                error = "expected 'open <savings|current> <initial-deposit> <pin> <customer name>'";
+                return -1;
+            }
+            string type = toLowerCopy(string(fields[1]));
+            if (type != "savings" && type != "current") {
+                error = "field 'type': expected savings or current, found \"" + string(fields[1]) + "\"";
+                return -1;
+            }
+            if (!parseAmount(fields[2], amount)) {
+                return -1;
+            }
+            string pin(fields[3]);
+            if (!isValidPin(pin)) {
+                error = "field 'pin': PIN must be exactly 4 digits";
+                return -1;
+            }
+            if (!isPinUnique(pin)) {
+                return 0;
+            }
+            size_t nameStart = fields[4].data() - line.data();
+            string name(InputScanner::trim(line.substr(nameStart)));
+            Customer customer(name, "", "", pin);
+            return openAccount(customer, type == "savings" ? "Savings" : "Current", amount) ? 1 : 0;
+        }
+        if (command == "close") {
+            if (!needFields(2, "close <account>") || !parseAccount(fields[1], accountNumber, "account")) {
+                return -1;
+            }
+            if (!findAccount(accountNumber)) {
+                return 0;
+            }
+            closeAccount(accountNumber);
+            return findAccount(accountNumber) ? 0 : 1;
+        }
+        if (command == "interest") {
+            if (!needFields(1, "interest")) {
+                return -1;
+            }
+            postMonthEndInterest();
+            return 1;
+        }
+        if (command == "hot") {
+            string mode = count == 3 ? toLowerCopy(string(fields[2])) : string();
+            if (!needFields(3, "hot <account> on|off") || !parseAccount(fields[1], accountNumber, "account")) {
+                return -1;
+            }
+            if (mode != "on" && mode != "off") {
+                error = "field 'mode': expected on or off, found \"" + string(fields[2]) + "\"";
+                return -1;
+            }
+            return setAccountHot(accountNumber, mode == "on", 0) ? 1 : 0;
+        }
+        if (command == "save") {
+            if (!needFields(2, "save <filename>")) {
+                return -1;
+            }
+            saveToFile(string(fields[1]));
+            return 1;
+        }
+        if (command == "capture-start") {
+            if (!needFields(2, "capture-start <trace-file>")) {
+                return -1;
+            }
+            return startCapture(string(fields[1])) ? 1 : 0;
+        }
+        if (command == "capture-stop") {
+            if (!needFields(1, "capture-stop")) {
+                return -1;
+            }
+            return stopCapture() ? 1 : 0;
+        }
+        error = "unknown command \"" + string(fields[0]) + "\"";
+        return -1;
+    }
+
+    void runBatchFromMenu() {
+        string filename;
+        cout << "Enter batch command filename: ";
+        clearInputBuffer();
+        getline(cin, filename);
+        cout << "Show per-command output? (y/n): ";
+        string answer;
+        getline(cin, answer);
+        runBatchFile(filename, answer != "y" && answer != "Y");
+    }
+
+    void exportData() {
+        foldAllHotCredits();
+        int choice;
+        cout << "\n--- Export Data ---" << endl;
+        cout << "1. Accounts (CSV)" << endl;
+        cout << "2. Accounts (Fixed-Width)" << endl;
+        cout << "3. Transactions (CSV)" << endl;
+        cout << "4. Transactions (Fixed-Width)" << endl;
+        cout << "5. Transaction History Archive (Compact)" << endl;
+        cout << "6. Transactions (CSV) from an Archive" << endl;
+        cout << "7. Back to Main Menu" << endl;
+        cout << "Enter choice (1-7): ";
+        choice = getIntInput();
+        if (choice == 7) {
+            return;
+        }
+        if (choice < 1 || choice > 7) {
+            cout << "Invalid choice!" << endl;
+            return;
+        }
+        string filename;
+        cout << "Enter filename to export to: ";
+        clearInputBuffer();
+        getline(cin, filename);
+        if (choice <= 2) {
+            exportAccounts(filename, choice == 1);
+        }
+        else if (choice <= 4) {
+            exportTransactions(filename, choice == 3);
+        }
+        else if (choice == 5) {
+            archiveHistory(filename);
+        }
+        else {
+            string archive;
+            cout << "Enter archive to read: ";
+            getline(cin, archive);
+            expandArchive(archive, filename);
+        }
+    }
+
+    void browseAccounts() {
+        const int pageSize = 10;
+        int choice;
+        cout << "\n--- Sorted Listings & Search ---" << endl;
+        cout << "1. Largest Balances" << endl;
+        cout << "2. Most Overdrawn Current Accounts" << endl;
+        cout << "3. Search by Customer Name Prefix" << endl;
+        cout << "4. All Accounts by Customer Name" << endl;
+        cout << "5. Back to Main Menu" << endl;
+        cout << "Enter choice (1-5): ";
+        choice = getIntInput();
+        if (choice == 5) {
+            return;
+        }
+        if (choice < 1 || choice > 5) {
+            cout << "Invalid choice!" << endl;
+            return;
+        }
+        string prefix;
+        if (choice == 3) {
+            cout << "Enter name prefix: ";
+            clearInputBuffer();
+            getline(cin, prefix);
+        }
+        IndexCursor cursor;
+        int shown = 0;
+        while (true) {
+            vector<int> page;
+            if (choice == 1) {
+                page = accountIndex.largestBalances(pageSize, cursor);
+            }
+            else if (choice == 2) {
+                page = accountIndex.mostOverdrawn("Current", pageSize, cursor);
+            }
+            else {
+                page = accountIndex.namePrefix(prefix, pageSize, cursor);
+            }
+            if (page.empty() && shown == 0) {
+                cout << "No matching accounts found!" << endl;
+                return;
+            }
+            {
+                ReportWriter out(cout);
+                if (shown == 0) {
+                    out.newline();
+                    displayAccountHeader(out);
+                }
+                for (int accNum : page) {
+                    Account* account = findAccount(accNum);
+                    if (account) {
+                        displayAccountRow(out, account);
+                    }
+                }
+            }
+            shown += static_cast<int>(page.size());
+            if (cursor.exhausted) {
+                break;
+            }
+            string answer;
+            cout << "Show next page? (y/n): ";
+            cin >> answer;
+            if (answer != "y" && answer != "Y") {
+                break;
+            }
+        }
+        cout << shown << " account(s) listed." << endl;
+    }
+
+    // Month-end run. Only savings accounts touched since the last run are visited: their unaccrued
+    // days are gathered into flat arrays for one computeInterest pass and the totals posted. Accounts
+    // nobody used keep accruing lazily and post on their next access or statement.
+    void postMonthEndInterest() {
+        foldAllHotCredits();
+        lock_guard<mutex> guard(bookMutex);
+        time_t now = currentTime();
+        vector<SavingsAccount*> savings(touchedSavings.begin(), touchedSavings.end());
+        touchedSavings.clear();
+        vector<long long> balances, rates, days;
+        for (SavingsAccount* account : savings) {
+            balances.push_back(account->getBalance().getCents());
+            rates.push_back(account->getInterestRateMicros());
+            days.push_back(account->daysUnaccrued(now));
+        }
+        vector<long long> interest(savings.size());
+        computeInterest(balances.data(), rates.data(), days.data(), interest.data(), savings.size());
+        vector<const Account*> changed;
+        for (size_t i = 0; i < savings.size(); i++) {
+            Money before = savings[i]->getBalance();
+            savings[i]->addAccrual(Money::fromCents(interest[i]), days[i]);
+            if (savings[i]->postAccruedInterest(now)) {
+                noteBalanceChange(savings[i], before);
+                // The posting itself is not new activity
+                touchedSavings.erase(savings[i]);
+                changed.push_back(savings[i]);
+            }
+        }
+        if (!changed.empty()) {
+            snapshots.publishAccounts(changed.data(), static_cast<int>(changed.size()));
+        }
+        capture(TRACE_MONTH_END_INTEREST, 0, 0, Money(), true, now);
+        cout << "Month-end interest posted to " << changed.size() << " of " << savings.size()
+            << " savings account(s) touched since the last run." << endl;
+    }
+
+    // Posts accrued interest on every savings account, e.g. before statements are produced
+    void postAllAccruedInterest() {
+        lock_guard<mutex> guard(bookMutex);
+        time_t now = currentTime();
+        vector<const Account*> changed;
+        for (int i = 0; i < accountCount; i++) {
+            if (settleInterest(accounts[i], now)) {
+                changed.push_back(accounts[i]);
+            }
+        }
+        if (!changed.empty()) {
+            snapshots.publishAccounts(changed.data(), static_cast<int>(changed.size()));
+        }
+        capture(TRACE_POST_ALL_INTEREST, 0, 0, Money(), true, now);
+    }
+
+    Loan* executeLoanDisbursement(Account* account, Money principal, int duration) {
+        lock_guard<mutex> guard(bookMutex);
+        if (loanCount >= MAX_LOANS) {
+            cout << "Maximum number of loans reached!" << endl;
+            return nullptr;
+        }
+        if (!creditAllowed(account, principal)) {
+            return nullptr;
+        }
+        int accountNumber = account->getAccountNumber();
+        Loan* loan = new Loan(account->getCustomerRef().getCustomerID(), principal, 0.05, duration);
+        loans[loanCount] = loan;
+        loanCount++;
+        Money before = account->getBalance();
+        account->deposit(principal);
+        Transaction transaction("Loan Disbursement", principal, accountNumber);
+        account->addTransaction(transaction);
+        noteBalanceChange(account, before);
+        publish(account);
+        snapshots.publishLoans(loans, loanCount);
+        cout << "Loan approved! $" << principal << " deposited to account "
+            << accountNumber << endl;
+        loan->display();
+        return loan;
+    }
+
+    void executeLoanPayment(Loan* loan, Money amount) {
+        lock_guard<mutex> guard(bookMutex);
+        loan->makePayment(amount);
+        snapshots.publishLoans(loans, loanCount);
+        if (!loan->isActive()) {
+            cout << "Loan fully repaid!" << endl;
+        }
+    }
+
+    Loan* findLoan(int loanID) {
+        for (int i = 0; i < loanCount; i++) {
+            if (loans[i] && loans[i]->getLoanID() == loanID) {
+                return loans[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Account balances as of now, unposted interest included, and loan remainders, ordered by
+    // number, as a trace records them at the end. Counting accrued interest keeps the book independent
+    // of which reads happened to post it.
+    void traceBook(vector<pair<int, Money>>& balances, vector<pair<int, Money>>& loanBalances, time_t now) {
+        foldAllHotCredits();
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        balances.clear();
+        loanBalances.clear();
+        for (int slot = 0; slot < image->accountCount; slot++) {
+            const AccountState& state = image->account(slot);
+            balances.emplace_back(state.identity->accountNumber, state.balanceAsOf(now));
+        }
+        for (const Loan& loan : *image->loans) {
+            loanBalances.emplace_back(loan.getLoanID(), loan.getRemainingBalance());
+        }
+        sort(balances.begin(), balances.end());
+        sort(loanBalances.begin(), loanBalances.end());
+    }
+
+    // Saves the book a replay starts from beside the trace (trace file + ".book"), then records
+    // every operation that can change it until stopCapture. The save file has no velocity state or
+    // hot flags, so the trace opens with the current rules, the debits still inside their windows
+    // and the accounts that are hot.
+    bool startCapture(const string& traceFile) {
+        if (recorder) {
+            cout << "Traffic is already being captured!" << endl;
+            return false;
+        }
+        time_t now = currentTime();
+        saveToFile(traceFile + ".book");
+        unique_ptr<TraceRecorder> next(new TraceRecorder(traceFile, now));
+        if (!next->isOpen()) {
+            cout << "Cannot write trace file " << traceFile << "!" << endl;
+            return false;
+        }
+        lock_guard<mutex> guard(bookMutex);
+        recorder = move(next);
+        captureVelocityRule(0, velocity.getDefaultRule(), now);
+        for (const auto& entry : velocity.getAccountRules()) {
+            captureVelocityRule(entry.first, entry.second, now);
+        }
+        velocity.forEachRecentDebit([&](int accountNumber, time_t bucketStart, int count, Money amount) {
+            TraceRecord record;
+            record.op = TRACE_VELOCITY_DEBITS;
+            record.applied = true;
+            record.when = now;
+            record.account = accountNumber;
+            record.amount = amount;
+            record.due = static_cast<long long>(bucketStart);
+            record.period = count;
+            capture(record);
+        });
+        for (const Account* account : stripedAccounts) {
+            if (account->isHot()) {
+                capture(TRACE_HOT_ON, account->getAccountNumber(), account->getCreditStripes()->getStripeCount(), Money(), true, now);
+            }
+        }
+        cout << "Capturing traffic to " << traceFile << endl;
+        return true;
+    }
+
+    bool stopCapture() {
+        if (!recorder) {
+            cout << "Traffic is not being captured!" << endl;
+            return false;
+        }
+        time_t now = currentTime();
+        vector<pair<int, Money>> balances, loanBalances;
+        traceBook(balances, loanBalances, now);
+        bool written = recorder->finish(now, balances, loanBalances);
+        cout << "Captured " << recorder->getRecordCount() << " operation(s)"
+            << (written ? "." : ", but the trace could not be written!") << endl;
+        recorder.reset();
+        return written;
+    }
+
+    bool isCapturing() const { return recorder != nullptr; }
+
+    // Applies one captured operation; true when the bank applied it, as recorded at capture. The
+    // replaying bank is not capturing, so the public entry points used here record nothing.
+    bool replayOperation(const TraceRecord& record) {
+        switch (record.op) {
+        case TRACE_DEPOSIT:
+        case TRACE_WITHDRAWAL: {
+            Account* account = findAccount(record.account);
+            if (!account) {
+                return false;
+            }
+            return record.op == TRACE_DEPOSIT ? executeDeposit(account, record.amount)
+                : executeWithdrawal(account, record.amount);
+        }
+        case TRACE_TRANSFER: {
+            Account* fromAccount = findAccount(record.account);
+            Account* toAccount = findAccount(record.other);
+            return fromAccount && toAccount && executeTransfer(fromAccount, toAccount, record.amount);
+        }
+        case TRACE_LOAN: {
+            Account* account = findAccount(record.account);
+            return account && executeLoanDisbursement(account, record.amount, record.other) != nullptr;
+        }
+        case TRACE_LOAN_PAYMENT: {
+            Loan* loan = findLoan(record.account);
+            if (!loan) {
+                return false;
+            }
+            executeLoanPayment(loan, record.amount);
+            return true;
+        }
+        case TRACE_MONTH_END_INTEREST:
+            postMonthEndInterest();
+            return true;
+        case TRACE_OPEN_ACCOUNT: {
+            if (record.text.size() != 5) {
+                return false;
+            }
+            // Customer IDs are handed out as customers are entered, including ones that never got
+            // an account, so the new customer takes the ID it had at capture
+            Customer::setNextCustomerID(record.other);
+            Customer customer(record.text[1], record.text[2], record.text[3], record.text[4]);
+            Account* account = registerAccount(customer, record.text[0], record.amount);
+            return account && account->getAccountNumber() == record.account;
+        }
+        case TRACE_CLOSE_ACCOUNT:
+            return removeAccount(record.account);
+        case TRACE_HOT_ON:
+        case TRACE_HOT_OFF:
+            return setAccountHot(record.account, record.op == TRACE_HOT_ON, record.other);
+        case TRACE_SCHEDULE:
+            return addStandingOrder(record.account, record.other, record.amount, static_cast<time_t>(record.due),
+                record.period) > 0;
+        case TRACE_CANCEL_ORDER:
+            return cancelStandingOrder(record.account);
+        case TRACE_RUN_DUE:
+            return runDueTransfers(record.when) > 0;
+        case TRACE_VELOCITY_RULE: {
+            VelocityRule rule;
+            rule.maxOperations = record.other;
+            rule.maxAmount = record.amount;
+            rule.windowSeconds = static_cast<int>(record.period);
+            setVelocityRule(record.account, rule);
+            return true;
+        }
+        case TRACE_VELOCITY_CLEAR:
+            clearVelocityRule(record.account);
+            return true;
+        case TRACE_VELOCITY_DEBITS: {
+            lock_guard<mutex> guard(bookMutex);
+            velocity.seedDebits(record.account, static_cast<time_t>(record.due), static_cast<int>(record.period), record.amount);
+            return true;
+        }
+        case TRACE_POST_ALL_INTEREST:
+            postAllAccruedInterest();
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void manageLoans() {
+        int accountNumber;
+        cout << "Enter account number: ";
+        accountNumber = getIntInput();
+        Account* account = findAccount(accountNumber);
+        if (!account) {
+            cout << "Account " << accountNumber << " not found!" << endl;
+            return;
+        }
+        if (!authenticate(accountNumber)) {
+            return;
+        }
+        int choice;
+        cout << "\n--- Loan Management ---" << endl;
+        cout << "1. Apply for a Loan" << endl;
+        cout << "2. View Loan Details" << endl;
+        cout << "3. Make Loan Payment" << endl;
+        cout << "4. View Amortization Schedule" << endl;
+        cout << "5. Back to Main Menu" << endl;
+        cout << "Enter choice (1-5): ";
+        choice = getIntInput();
+        if (choice == 1) {
+            int custID = account->getCustomer().getCustomerID();
+            for (int i = 0; i < loanCount; i++) {
+                if (loans[i] && loans[i]->getCustomerID() == custID && loans[i]->isActive()) {
+                    cout << "Customer already has an active loan!" << endl;
+                    return;
+                }
+            }
+            Money principal;
+            int duration;
+            cout << "Enter loan amount ($1000-$50000): $";
+            principal = getMoneyInput();
+            if (principal < Money::fromCents(100000) || principal > Money::fromCents(5000000)) {
+                cout << "Loan amount must be between $1000 and $50000!" << endl;
+                return;
+            }
+            if (principal > account->getBalance() * 5) {
+                cout << "Loan rejected! Amount exceeds 5x account balance ($"
+                    << account->getBalance() << ")." << endl;
+                return;
+            }
+            cout << "Enter loan duration (12-60 months): ";
+            duration = getIntInput();
+            if (duration < 12 || duration > 60) {
+                cout << "Duration must be between 12 and 60 months!" << endl;
+                return;
+            }
+            time_t when = currentTime();
+            capture(TRACE_LOAN, accountNumber, duration, principal, executeLoanDisbursement(account, principal, duration) != nullptr, when);
+        }
+        else if (choice == 2) {
+            int loanID;
+            cout << "Enter loan ID: ";
+            loanID = getIntInput();
+            for (int i = 0; i < loanCount; i++) {
+                if (loans[i] && loans[i]->getLoanID() == loanID) {
+                    loans[i]->display();
+                    return;
+                }
+            }
+            cout << "Loan " << loanID << " not found!" << endl;
+        }
+        else if (choice == 3) {
+            int loanID;
+            Money amount;
+            cout << "Enter loan ID: ";
+            loanID = getIntInput();
+            Loan* loan = nullptr;
+            for (int i = 0; i < loanCount; i++) {
+                if (loans[i] && loans[i]->getLoanID() == loanID) {
+                    loan = loans[i];
+                    break;
+                }
+            }
+            if (!loan) {
+                cout << "Loan " << loanID << " not found!" << endl;
+                return;
+            }
+            cout << "Enter payment amount: $";
+            amount = getMoneyInput();
+            time_t when = currentTime();
+            executeLoanPayment(loan, amount);
+            capture(TRACE_LOAN_PAYMENT, loanID, 0, amount, true, when);
+        }
+        else if (choice == 4) {
+            int loanID;
+            cout << "Enter loan ID: ";
+            loanID = getIntInput();
+            displayAmortizationSchedule(loanID);
         }
-        for (int i = 0; i < MAX_LOANS; i++) {
-            loans[i] = nullptr;
+        else if (choice == 5) {
+            return;
+        }
+        else {
+            cout << "Invalid choice!" << endl;
         }
-        cout << "Welcome to " << bankName << "!" << endl;
     }
 
-    ~Bank() {
-        for (int i = 0; i < accountCount; i++) {
-            if (accounts[i] != nullptr) {
-                delete accounts[i];
-                accounts[i] = nullptr;
+    // Month-by-month schedule for one loan, from its remaining balance until it is repaid
+    void displayAmortizationSchedule(int loanID) {
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        for (const Loan& loan : *image->loans) {
+            if (loan.getLoanID() != loanID) {
+                continue;
+            }
+            if (!loan.isActive()) {
+                cout << "Loan " << loanID << " is fully repaid." << endl;
+                return;
             }
+            AmortizationEngine engine;
+            engine.addLoan(loan);
+            vector<PortfolioMonth> schedule;
+            engine.project(engine.monthsToRepay(), schedule, nullptr);
+            cout << "\n--- Amortization Schedule for Loan " << loanID << " ---" << endl;
+            ReportWriter out(cout);
+            AmortizationEngine::displaySchedule(out, schedule, false);
+            return;
         }
-        for (int i = 0; i < loanCount; i++) {
-            if (loans[i] != nullptr) {
-                delete loans[i];
-                loans[i] = nullptr;
+        cout << "Loan " << loanID << " not found!" << endl;
+    }
+
+    // Projects every active loan in the published book forward, printing portfolio cash flow per month
+    // and optionally streaming each loan's schedule to a columnar file. Works from a snapshot, so
+    // payments taken while it runs are not seen.
+    void projectLoanPortfolio() {
+        shared_ptr<const BookImage> image = snapshots.acquire();
+        AmortizationEngine engine;
+        for (const Loan& loan : *image->loans) {
+            if (loan.isActive()) {
+                engine.addLoan(loan);
             }
         }
+        if (engine.size() == 0) {
+            cout << "No active loans to project." << endl;
+            return;
+        }
+        int months;
+        string filename;
+        cout << "Enter months to project (0 = until every loan is repaid): ";
+        months = getIntInput();
+        if (months <= 0) {
+            months = engine.monthsToRepay();
+        }
+        cout << "Enter filename for the columnar schedule (blank for none): ";
+        clearInputBuffer();
+        getline(cin, filename);
+        ofstream outFile;
+        if (!filename.empty()) {
+            outFile.open(filename, ios::binary);
+            if (!outFile) {
+                cerr << "Error opening file for writing!" << endl;
+                return;
+            }
+        }
+        vector<PortfolioMonth> totals;
+        auto started = chrono::steady_clock::now();
+        engine.project(months, totals, outFile.is_open() ? &outFile : nullptr);
+        outFile.close();
+        double seconds = secondsSince(started);
+        cout << "\n--- Loan Portfolio Projection (" << engine.size() << " loan(s), " << months << " month(s)) ---" << endl;
+        ReportWriter out(cout);
+        AmortizationEngine::displaySchedule(out, totals, true);
+        out.flush();
+        cout << "Projected in " << formatDouble(seconds * 1000) << " ms" << endl;
+        if (!filename.empty()) {
+            cout << "Columnar schedule written to " << filename << endl;
+        }
     }
 
-    bool isPinUnique(const string& pin) const {
-        for (int i = 0; i < accountCount; i++) {
-            if (accounts[i] && accounts[i]->getCustomer().getPin() == pin) {
+    // Saves from a published snapshot, so writers carry on while the file is written. Background
+    // checkpoints skip the fold, so credits still sitting in hot stripes are left out of them.
+    void saveToFile(const string& filename) {
+        foldAllHotCredits();
+        ofstream outFile(filename);
+        if (!outFile) {
+            cerr << "Error opening file for writing!" << endl;
+            return;
+        }
+        writeBookImage(*snapshots.acquire(), outFile);
+        outFile.close();
+        cout << "Data saved successfully to " << filename << endl;
+    }
+
+    static bool loadStandingOrders(InputScanner& in, vector<StandingOrder>& orders, int& nextOrderID) {
+        int records = 0;
+        if (!in.readInt(records, "standing order count") || !in.readInt(nextOrderID, "next standing order ID")) {
+            return false;
+        }
+        if (records < 0) {
+            return in.fail("standing order count", to_string(records) + " is negative");
+        }
+        for (int i = 0; i < records; i++) {
+            StandingOrder order;
+            long long nextDue = 0;
+            if (!in.readInt(order.orderID, "standing order ID") || !in.readInt(order.fromAccount, "standing order source")
+                || !in.readInt(order.toAccount, "standing order destination") || !in.readMoney(order.amount, "standing order amount")
+                || !in.readLongLong(nextDue, "standing order due time")
+                || !in.readLongLong(order.intervalSeconds, "standing order interval")) {
                 return false;
             }
+            if (order.amount <= Money() || order.intervalSeconds < 0) {
+                return in.fail("standing order", "order " + to_string(order.orderID) + " has a non-positive amount or negative interval");
+            }
+            order.nextDue = static_cast<time_t>(nextDue);
+            orders.push_back(order);
         }
         return true;
     }
 
-    bool verifyCustomerPin(int accountNumber, const string& pin) const {
-        Account* account = findAccount(accountNumber);
-        if (account && account->getCustomer().getPin() == pin) {
-            return true;
+    // Savings accounts missing from the section keep the load time as their accrual start
+    static bool loadInterestAccrual(InputScanner& in, const vector<Account*>& loadedAccounts) {
+        int records = 0;
+        if (!in.readInt(records, "accrual count")) {
+            return false;
         }
-        cout << "Invalid PIN!" << endl;
-        return false;
+        for (int i = 0; i < records; i++) {
+            int accountNumber = 0;
+            long long accruedSince = 0;
+            Money accrued;
+            if (!in.readInt(accountNumber, "accrual account number") || !in.readLongLong(accruedSince, "accrual start")
+                || !in.readMoney(accrued, "accrued interest")) {
+                return false;
+            }
+            SavingsAccount* savings = nullptr;
+            for (Account* account : loadedAccounts) {
+                if (account->getAccountNumber() == accountNumber) {
+                    savings = dynamic_cast<SavingsAccount*>(account);
+                    break;
+                }
+            }
+            if (!savings) {
+                return in.fail("accrual account number", to_string(accountNumber) + " is not a savings account in this file");
+            }
+            savings->restoreAccrual(static_cast<time_t>(accruedSince), accrued);
+        }
+        return true;
     }
 
-    void createAccount() {
-        if (accountCount >= MAX_ACCOUNTS) {
-            cout << "Maximum number of accounts reached!" << endl;
-            return;
+    // Parses the whole file before touching the live book, so a damaged file leaves it unchanged
+    bool loadFromFile(const string& filename) {
+        if (recorder) {
+            cout << "Stop traffic capture before loading a book; the trace cannot follow it." << endl;
+            return false;
         }
-        Customer customer;
-        customer.inputDetails();
-        string pin;
-        bool validPin = false;
-        while (!validPin) {
-            pin = getPinInput();
-            if (!isValidPin(pin)) {
-                cout << "PIN must be exactly 4 digits!" << endl;
-                continue;
+        ifstream inFile(filename, ios::binary);
+        if (!inFile) {
+            cerr << "Error opening file for reading!" << endl;
+            return false;
+        }
+        int savedAccNum = Account::getNextAccountNumber();
+        int savedCustID = Customer::getNextCustomerID();
+        int savedTransID = Transaction::getNextTransactionID();
+        int savedLoanID = Loan::getNextLoanID();
+        InputScanner in(inFile);
+        string loadedName;
+        int loadedAccountCount = 0, loadedLoanCount = 0;
+        int nextAccNum = 0, nextCustID = 0, nextTransID = 0, nextLoanID = 0;
+        vector<Account*> loadedAccounts;
+        vector<Loan*> loadedLoans;
+        vector<StandingOrder> loadedOrders;
+        int loadedNextOrderID = 1;
+        bool ok = in.readLine(loadedName, "bank name") && in.readInt(loadedAccountCount, "account count")
+            && in.readInt(nextAccNum, "next account number") && in.readInt(nextCustID, "next customer ID")
+            && in.readInt(nextTransID, "next transaction ID") && in.readInt(loadedLoanCount, "loan count")
+            && in.readInt(nextLoanID, "next loan ID");
+        if (ok && (loadedAccountCount < 0 || loadedAccountCount > MAX_ACCOUNTS)) {
+            ok = in.fail("account count", to_string(loadedAccountCount) + " is outside 0-" + to_string(MAX_ACCOUNTS));
+        }
+        if (ok && (loadedLoanCount < 0 || loadedLoanCount > MAX_LOANS)) {
+            ok = in.fail("loan count", to_string(loadedLoanCount) + " is outside 0-" + to_string(MAX_LOANS));
+        }
+        for (int i = 0; ok && i < loadedAccountCount; i++) {
+            string accountType;
+            ok = in.readLine(accountType, "account type");
+            Account* account = nullptr;
+            if (!ok) {
+                break;
             }
-            if (!isPinUnique(pin)) {
-                cout << "PIN already in use! Please choose a different PIN." << endl;
+            if (accountType == "Savings") {
+                account = new SavingsAccount(Customer("", "", ""));
+            }
+            else if (accountType == "Current") {
+                account = new CurrentAccount(Customer("", "", ""));
+            }
+            else {
+                ok = in.fail("account type", "unknown account type \"" + accountType + "\"");
+                break;
+            }
+            loadedAccounts.push_back(account);
+            ok = account->loadFromFile(in);
+        }
+        for (int i = 0; ok && i < loadedLoanCount; i++) {
+            Loan* loan = new Loan();
+            loadedLoans.push_back(loan);
+            ok = loan->loadFromFile(in);
+        }
+        string_view section;
+        while (ok && in.nextLine(section)) {
+            if (section.empty()) {
                 continue;
             }
-            validPin = true;
+            if (section == INTEREST_ACCRUAL_SECTION) {
+                ok = loadInterestAccrual(in, loadedAccounts);
+            }
+            else if (section == STANDING_ORDERS_SECTION) {
+                ok = loadStandingOrders(in, loadedOrders, loadedNextOrderID);
+            }
+            else {
+                ok = in.fail("section", "unknown section \"" + string(section) + "\"");
+            }
         }
-        customer.setPin(pin);
-        int choice;
-        double initialDeposit;
-        cout << "\nSelect Account Type:" << endl;
-        cout << "1. Savings Account" << endl;
-        cout << "2. Current Account" << endl;
-        cout << "Enter choice (1-2): ";
-        choice = getIntInput();
-        cout << "Enter initial deposit amount: $";
-        initialDeposit = getDoubleInput();
-        Account* newAccount = nullptr;
-        if (choice == 1) {
-            newAccount = new SavingsAccount(customer, initialDeposit);
-            cout << "\nSavings Account created successfully!" << endl;
+        inFile.close();
+        if (!ok) {
+            for (Account* account : loadedAccounts) {
+                delete account;
+            }
+            for (Loan* loan : loadedLoans) {
+                delete loan;
+            }
+            Account::setNextAccountNumber(savedAccNum);
+            Customer::setNextCustomerID(savedCustID);
+            Transaction::setNextTransactionID(savedTransID);
+            Loan::setNextLoanID(savedLoanID);
+            cerr << "Error loading " << filename << " at " << in.describeError() << endl;
+            cerr << "Existing data was left unchanged." << endl;
+            return false;
         }
-        else if (choice == 2) {
-            newAccount = new CurrentAccount(customer, initialDeposit);
-            cout << "\nCurrent Account created successfully!" << endl;
+
+        lock_guard<mutex> guard(bookMutex);
+        for (int i = 0; i < accountCount; i++) {
+            velocity.forgetAccount(accounts[i]->getAccountNumber());
+            accounts[i] = nullptr;
+        }
+        for (int i = 0; i < loanCount; i++) {
+            delete loans[i];
+            loans[i] = nullptr;
+        }
+        bankName = loadedName;
+        accountCount = loadedAccountCount;
+        loanCount = loadedLoanCount;
+        accountIndex.clear();
+        touchedSavings.clear();
+        stripedAccounts.clear();
+        for (int i = 0; i < accountCount; i++) {
+            accounts[i] = loadedAccounts[i];
+            accountIndex.insert(accounts[i]);
+        }
+        for (int i = 0; i < loanCount; i++) {
+            loans[i] = loadedLoans[i];
+        }
+        // Counters are restored last because constructing the placeholder accounts advanced them
+        Account::setNextAccountNumber(nextAccNum);
+        Customer::setNextCustomerID(nextCustID);
+        Transaction::setNextTransactionID(nextTransID);
+        Loan::setNextLoanID(nextLoanID);
+        time_t loadedAt = currentTime();
+        journal.reset(loadedAt);
+        for (int i = 0; i < accountCount; i++) {
+            journal.recordOpen(accounts[i]->getAccountNumber(), accounts[i]->getBalance(), loadedAt);
+        }
+        journal.takeCheckpoint(loadedAt);
+        scheduler.restore(loadedOrders, loadedNextOrderID, loadedAt);
+        sessions.clear(loadedAt);
+        terminalSession.clear();
+        batchSessions.clear();
+        republishAll();
+        publishStandingOrders();
+        cout << "Data loaded successfully from " << filename << endl;
+        return true;
+    }
+};
+
+// IdCounterGuard - puts the account, customer, transaction and loan ID counters back on scope exit,
+// so scratch banks built by benchmarks and replays leave the live bank's numbering untouched
+class IdCounterGuard {
+private:
+    int accountNumber;
+    int customerID;
+    int transactionID;
+    int loanID;
+
+public:
+    IdCounterGuard()
+        : accountNumber(Account::getNextAccountNumber()), customerID(Customer::getNextCustomerID()),
+          transactionID(Transaction::getNextTransactionID()), loanID(Loan::getNextLoanID()) {}
+    ~IdCounterGuard() {
+        Account::setNextAccountNumber(accountNumber);
+        Customer::setNextCustomerID(customerID);
+        Transaction::setNextTransactionID(transactionID);
+        Loan::setNextLoanID(loanID);
+    }
+    IdCounterGuard(const IdCounterGuard&) = delete;
+    IdCounterGuard& operator=(const IdCounterGuard&) = delete;
+};
+
+// BenchmarkRandom - small xorshift generator so every benchmark run replays the same workload
+class BenchmarkRandom {
+private:
+    unsigned long long state;
+
+public:
+    explicit BenchmarkRandom(unsigned long long seed) : state(seed ? seed : 0x9E3779B97F4A7C15ULL) {}
+
+    unsigned long long next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int nextInt(int bound) { return static_cast<int>(next() % static_cast<unsigned long long>(bound)); }
+};
+
+// Fills a bank with alternating Savings/Current accounts, each opened with the same balance
+vector<Account*> populateBenchmarkBank(Bank& bank, int accountCount, Money openingBalance) {
+    vector<Account*> opened;
+    for (int i = 0; i < accountCount; i++) {
+        string pin = to_string(1000 + i);
+        Customer customer("Bench Customer " + to_string(i), "1 Benchmark Way", "555-0100", pin);
+        Account* account = bank.openAccount(customer, i % 2 == 0 ? "Savings" : "Current", openingBalance);
+        if (!account) {
+            break;
+        }
+        opened.push_back(account);
+    }
+    return opened;
+}
+
+// Replays a deposit/withdrawal/transfer mix through the bank's post-authentication paths
+void runOperationMix(Bank& bank, const vector<Account*>& opened, int operations, unsigned long long seed) {
+    BenchmarkRandom random(seed);
+    int count = static_cast<int>(opened.size());
+    for (int i = 0; i < operations; i++) {
+        int kind = random.nextInt(100);
+        Account* account = opened[random.nextInt(count)];
+        Money amount = Money::fromCents(1000 + random.nextInt(4000));
+        if (kind < 45) {
+            bank.executeDeposit(account, amount);
+        }
+        else if (kind < 80) {
+            bank.executeWithdrawal(account, amount);
         }
         else {
-            cout << "Invalid choice! Account creation failed." << endl;
-            return;
+            Account* other = opened[random.nextInt(count)];
+            if (other != account) {
+                bank.executeTransfer(account, other, amount);
+            }
         }
-        accounts[accountCount] = newAccount;
-        accountCount++;
-        cout << "Account Number: " << newAccount->getAccountNumber() << endl;
     }
+}
 
-    Account* findAccount(int accountNumber) const {
-        for (int i = 0; i < accountCount; i++) {
-            if (accounts[i] && accounts[i]->getAccountNumber() == accountNumber) {
-                return accounts[i];
+void benchmarkVelocityChecks() {
+    const int operations = 200000;
+    const int rounds = 3;
+    const char* labels[] = { "No velocity rules", "Rules active, never tripped", "Strict rules (5 per 10 min)" };
+    VelocityRule rules[3];
+    rules[1].maxOperations = 1000000000;
+    rules[1].maxAmount = Money::fromCents(100000000000000LL);
+    rules[2].maxOperations = 5;
+    rules[2].maxAmount = Money::fromCents(100000000000000LL);
+    double best[3] = { 0.0, 0.0, 0.0 };
+    long long rejected[3] = { 0, 0, 0 };
+
+    // Configurations are interleaved round by round so machine noise hits them evenly
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < 3; i++) {
+            QuietOutput quiet;
+            IdCounterGuard counters;
+            Bank bank("Benchmark Bank");
+            vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, Money::fromCents(10000000));
+            bank.getVelocityEngine().setDefaultRule(rules[i]);
+            auto started = chrono::steady_clock::now();
+            runOperationMix(bank, opened, operations, 42);
+            double elapsed = secondsSince(started);
+            if (round == 0 || elapsed < best[i]) {
+                best[i] = elapsed;
             }
+            rejected[i] = bank.getVelocityEngine().getRejectedCount();
         }
-        return nullptr;
     }
 
-    void closeAccount(int accountNumber) {
-        for (int i = 0; i < accountCount; i++) {
-            if (accounts[i] && accounts[i]->getAccountNumber() == accountNumber) {
-                int custID = accounts[i]->getCustomer().getCustomerID();
-                for (int j = 0; j < loanCount; j++) {
-                    if (loans[j] && loans[j]->getCustomerID() == custID && loans[j]->isActive()) {
-                        cout << "Cannot close account. Customer has an active loan." << endl;
-                        return;
+    // The engine on its own, to separate its cost from the console and history work around it
+    VelocityEngine engine;
+    engine.setDefaultRule(rules[1]);
+    BenchmarkRandom random(7);
+    time_t now = time(nullptr);
+    auto started = chrono::steady_clock::now();
+    for (int i = 0; i < operations; i++) {
+        int accountNumber = 100 + random.nextInt(MAX_ACCOUNTS);
+        if (engine.allowDebit(accountNumber, Money::fromCents(2500), now + i / 1000)) {
+            engine.recordDebit(accountNumber, Money::fromCents(2500), now + i / 1000);
+        }
+    }
+    double engineSeconds = secondsSince(started);
+
+    cout << "\n--- Velocity Check Overhead (" << operations << " mixed operations, "
+        << MAX_ACCOUNTS << " accounts, best of " << rounds << ") ---" << endl;
+    double baseline = best[0] * 1e9 / operations;
+    for (int i = 0; i < 3; i++) {
+        double nsPerOp = best[i] * 1e9 / operations;
+        cout << formatString(labels[i], 30) << " | " << formatString(formatDouble(nsPerOp) + " ns/op", 14)
+            << " | vs. no rules " << formatString(formatDouble((nsPerOp / baseline - 1.0) * 100.0) + "%", 8)
+            << " | rejected " << rejected[i] << endl;
+    }
+    cout << formatString("Engine only (check + record)", 30) << " | "
+        << formatString(formatDouble(engineSeconds * 1e9 / operations) + " ns/op", 14) << endl;
+}
+
+void benchmarkPointInTimeQueries() {
+    const int changes = 1000000;
+    const int queries = 2000;
+    const size_t intervals[] = { 64, 1024, 16384 };
+    cout << "\n--- Point-in-Time Queries (" << changes << " journaled changes over "
+        << MAX_ACCOUNTS << " accounts) ---" << endl;
+    for (size_t interval : intervals) {
+        BalanceJournal journal;
+        journal.setCheckpointInterval(interval);
+        time_t base = journal.getHistoryStart();
+        for (int i = 0; i < MAX_ACCOUNTS; i++) {
+            journal.recordOpen(100 + i, Money::fromCents(100000), base);
+        }
+        BenchmarkRandom random(11);
+        auto started = chrono::steady_clock::now();
+        for (int i = 0; i < changes; i++) {
+            journal.recordChange(100 + random.nextInt(MAX_ACCOUNTS), Money::fromCents(random.nextInt(2000) - 1000), base + 1 + i);
+        }
+        double recordSeconds = secondsSince(started);
+
+        Money balance;
+        double checksum = 0.0;
+        started = chrono::steady_clock::now();
+        for (int i = 0; i < queries; i++) {
+            if (journal.balanceAsOf(100 + random.nextInt(MAX_ACCOUNTS), base + 1 + random.nextInt(changes), balance)) {
+                checksum += balance.toDouble();
+            }
+        }
+        double accountMicros = secondsSince(started) * 1e6 / queries;
+
+        vector<AccountBalance> book;
+        started = chrono::steady_clock::now();
+        for (int i = 0; i < queries / 10; i++) {
+            journal.bookAsOf(base + 1 + random.nextInt(changes), book);
+            checksum += book.size();
+        }
+        double bookMicros = secondsSince(started) * 1e6 / (queries / 10);
+
+        cout << "Interval " << formatString(to_string(interval), 6) << " | "
+            << formatString(formatDouble(recordSeconds * 1e9 / changes) + " ns/record", 16) << " | "
+            << formatString(formatDouble(accountMicros) + " us/account query", 24) << " | "
+            << formatString(formatDouble(bookMicros) + " us/book query", 20) << " | "
+            << journal.getCheckpointCount() << " checkpoints, " << journal.checkpointBytes() / 1024 << " KB" << endl;
+        benchmarkSink = checksum;
+    }
+}
+
+void benchmarkSnapshotReads() {
+    const double phaseSeconds = 1.0;
+    const char* labels[] = { "Writes only", "Writes + snapshot report reader", "Writes + locked report reader" };
+    cout << "\n--- Write Throughput While a Full-Book Report Runs (" << phaseSeconds << "s per phase, "
+        << thread::hardware_concurrency() << " hardware threads) ---" << endl;
+    for (int mode = 0; mode < 3; mode++) {
+        long long writes = 0;
+        long long reports = 0;
+        {
+            QuietOutput quiet;
+            IdCounterGuard counters;
+            Bank bank("Benchmark Bank");
+            vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, Money::fromCents(10000000));
+            atomic<bool> stop(false);
+            thread reader([&] {
+                if (mode == 0) {
+                    return;
+                }
+                NullBuffer sink;
+                ostream discard(&sink);
+                while (!stop.load(memory_order_relaxed)) {
+                    ReportWriter out(discard);
+                    if (mode == 1) {
+                        Bank::renderAccountList(out, *bank.acquireSnapshot());
                     }
+                    else {
+                        bank.renderLiveAccountList(out);
+                    }
+                    reports++;
                 }
-                cout << "Account " << accountNumber << " closed." << endl;
-                delete accounts[i];
-                for (int j = i; j < accountCount - 1; j++) {
-                    accounts[j] = accounts[j + 1];
+            });
+            auto started = chrono::steady_clock::now();
+            int count = static_cast<int>(opened.size());
+            while (secondsSince(started) < phaseSeconds) {
+                for (int i = 0; i < 256; i++) {
+                    bank.executeDeposit(opened[(writes + i) % count], Money::fromCents(100));
                 }
-                accounts[accountCount - 1] = nullptr;
-                accountCount--;
-                return;
+                writes += 256;
             }
+            stop = true;
+            reader.join();
         }
-        cout << "Account " << accountNumber << " not found!" << endl;
+        cout << formatString(labels[mode], 34) << " | "
+            << formatString(formatDouble(writes / phaseSeconds) + " writes/sec", 24) << " | "
+            << reports << " report(s)" << endl;
     }
+}
 
-    void depositToAccount(int accountNumber, double amount) {
-        Account* account = findAccount(accountNumber);
-        if (!account) {
-            cout << "Account " << accountNumber << " not found!" << endl;
-            return;
+// Latency percentiles of a sample of per-operation timings, in microseconds
+void reportLatency(const string& label, vector<double>& micros) {
+    sort(micros.begin(), micros.end());
+    size_t count = micros.size();
+    cout << formatString(label, 26) << " | p50 " << formatString(formatDouble(micros[count / 2]) + " us", 10)
+        << " | p99 " << formatString(formatDouble(micros[count * 99 / 100]) + " us", 10)
+        << " | max " << formatDouble(micros[count - 1]) << " us" << endl;
+}
+
+void benchmarkBackgroundCheckpoints() {
+    const int operations = 100000;
+    string path = (filesystem::temp_directory_path() / "bank_checkpoint_bench.txt").string();
+    cout << "\n--- Deposit Latency With Background Checkpoints (" << operations << " deposits) ---" << endl;
+    for (int mode = 0; mode < 2; mode++) {
+        vector<double> micros;
+        micros.reserve(operations);
+        CheckpointStats stats;
+        {
+            QuietOutput quiet;
+            IdCounterGuard counters;
+            Bank bank("Benchmark Bank");
+            vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, Money::fromCents(10000000));
+            if (mode == 1) {
+                bank.getCheckpointer().start(path, 10);
+            }
+            for (int i = 0; i < operations; i++) {
+                auto started = chrono::steady_clock::now();
+                bank.executeDeposit(opened[i % opened.size()], Money::fromCents(100));
+                micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - started).count());
+            }
+            bank.getCheckpointer().stop();
+            stats = bank.getCheckpointer().getStats();
         }
-        string pin = getPinInput();
-        if (!verifyCustomerPin(accountNumber, pin)) {
-            return;
+        reportLatency(mode == 0 ? "No checkpointer" : "Checkpoint every 10 ms", micros);
+        if (mode == 1 && stats.written > 0) {
+            long long captures = stats.written + stats.skipped;
+            cout << "  " << stats.written << " checkpoint(s), avg " << formatDouble(stats.totalMillis / stats.written)
+                << " ms each, capture stall avg " << formatDouble(stats.totalStallMicros / captures)
+                << " us, max " << formatDouble(stats.maxStallMicros) << " us" << endl;
         }
-        account->deposit(amount);
     }
+    error_code ec;
+    filesystem::remove(path, ec);
+}
 
-    void withdrawFromAccount(int accountNumber, double amount) {
-        Account* account = findAccount(accountNumber);
-        if (!account) {
-            cout << "Account " << accountNumber << " not found!" << endl;
-            return;
-        }
-        string pin = getPinInput();
-        if (!verifyCustomerPin(accountNumber, pin)) {
-            return;
+// Writes transaction records in the save-file layout until roughly targetBytes are on disk
+long long writeBenchmarkTransactions(const string& filename, long long targetBytes) {
+    ofstream outFile(filename, ios::binary);
+    ReportWriter writer(outFile);
+    BenchmarkRandom random(33);
+    const char* types[] = { "Deposit", "Withdrawal", "Transfer", "Interest" };
+    long long records = 0, written = 0;
+    while (written < targetBytes) {
+        writer.integer(10000 + records).newline();
+        writer.text("Mon Oct 12 09:41:27 2026").newline();
+        writer.text(types[random.next() % 4]).newline();
+        writer.money(Money::fromCents(static_cast<long long>(random.next() % 500000)), false).newline();
+        writer.integer(100 + random.next() % 1000).newline();
+        writer.integer(records % 4 == 2 ? 100 + static_cast<long long>(random.next() % 1000) : -1).newline();
+        records++;
+        if (records % 4096 == 0) {
+            writer.flush();
+            written = static_cast<long long>(outFile.tellp());
         }
-        account->withdraw(amount);
     }
+    writer.flush();
+    return records;
+}
 
-    void transferBetweenAccounts(int fromAccNum, int toAccNum, double amount) {
-        if (fromAccNum == toAccNum) {
-            cout << "Cannot transfer to the same account!" << endl;
-            return;
-        }
-        Account* fromAccount = findAccount(fromAccNum);
-        Account* toAccount = findAccount(toAccNum);
-        if (!fromAccount) {
-            cout << "Source account " << fromAccNum << " not found!" << endl;
-            return;
-        }
-        if (!toAccount) {
-            cout << "Destination account " << toAccNum << " not found!" << endl;
-            return;
-        }
-        string pin = getPinInput();
-        if (!verifyCustomerPin(fromAccNum, pin)) {
-            return;
+void benchmarkBulkParsing() {
+    cout << "File size in MB (0 for 256): ";
+    int megabytes = getIntInput();
+    if (megabytes <= 0) {
+        megabytes = 256;
+    }
+    string filename = (filesystem::temp_directory_path() / "bank_parse_benchmark.dat").string();
+    cout << "\nWriting " << megabytes << " MB of transaction records to " << filename << "..." << endl;
+    long long records = writeBenchmarkTransactions(filename, static_cast<long long>(megabytes) * 1024 * 1024);
+    double megabytesOnDisk = static_cast<double>(filesystem::file_size(filename)) / (1024.0 * 1024.0);
+
+    // The loader this replaced: formatted extraction plus getline per field
+    auto started = chrono::steady_clock::now();
+    long long streamRecords = 0;
+    double streamTotal = 0.0;
+    {
+        ifstream inFile(filename);
+        int transactionID, fromAccount, toAccount;
+        double amount;
+        string dateTime, type;
+        while (inFile >> transactionID) {
+            inFile.ignore();
+            getline(inFile, dateTime);
+            getline(inFile, type);
+            inFile >> amount >> fromAccount >> toAccount;
+            inFile.ignore();
+            streamTotal += amount;
+            streamRecords++;
         }
-        bool withdrawSuccess = fromAccount->withdraw(amount);
-        if (withdrawSuccess) {
-            toAccount->deposit(amount);
-            Transaction transaction("Transfer", amount, fromAccNum, toAccNum);
-            fromAccount->addTransaction(transaction);
-            toAccount->addTransaction(transaction);
-            cout << "Transfer of $" << formatDouble(amount);
-            cout << " from account " << fromAccNum << " to account " << toAccNum;
-            cout << " completed successfully." << endl;
+    }
+    double streamSeconds = secondsSince(started);
+
+    started = chrono::steady_clock::now();
+    long long scannerRecords = 0;
+    Money scannerTotal;
+    {
+        ifstream inFile(filename, ios::binary);
+        InputScanner in(inFile);
+        Transaction transaction;
+        while (scannerRecords < records && transaction.loadFromFile(in)) {
+            scannerTotal += transaction.getAmount();
+            scannerRecords++;
         }
     }
+    double scannerSeconds = secondsSince(started);
+    benchmarkSink = benchmarkSink + streamTotal + scannerTotal.toDouble();
+    filesystem::remove(filename);
+
+    cout << "\nParsed " << records << " records (" << formatDouble(megabytesOnDisk) << " MB)" << endl;
+    cout << formatString("Parser", 22) << formatString("Seconds", 10) << formatString("MB/sec", 12) << "Records/sec" << endl;
+    cout << formatLine(58) << endl;
+    cout << formatString("istream >> / getline", 22) << formatString(formatDouble(streamSeconds), 10)
+        << formatString(formatDouble(megabytesOnDisk / streamSeconds), 12) << formatDouble(streamRecords / streamSeconds) << endl;
+    cout << formatString("InputScanner", 22) << formatString(formatDouble(scannerSeconds), 10)
+        << formatString(formatDouble(megabytesOnDisk / scannerSeconds), 12) << formatDouble(scannerRecords / scannerSeconds) << endl;
+    if (streamRecords != records || scannerRecords != records || fabs(streamTotal - scannerTotal.toDouble()) > 0.005 * records) {
+        cout << "Warning: parsers disagree (" << streamRecords << " vs " << scannerRecords << " records)" << endl;
+    }
+    cout << "Speedup: " << formatDouble(streamSeconds / scannerSeconds) << "x" << endl;
+}
 
-    void displayAccount(int accountNumber) {
-        Account* account = findAccount(accountNumber);
-        if (account) {
-            account->display();
+// Bank-wide total and interest run over a large book, as doubles and as Money kernels
+void benchmarkMoneyKernels() {
+    const int accounts = 1 << 20;
+    const int passes = 20;
+    vector<long long> cents(accounts), rates(accounts), interest(accounts), days(accounts, 30);
+    vector<double> amounts(accounts), doubleRates(accounts), doubleInterest(accounts);
+    BenchmarkRandom random(34);
+    for (int i = 0; i < accounts; i++) {
+        cents[i] = random.nextInt(10000000) - 100000;
+        amounts[i] = cents[i] / 100.0;
+        doubleRates[i] = (i % 4 == 0) ? 0.031 : 0.025;
+        rates[i] = Money::rateToMicros(doubleRates[i]);
+    }
+    const char* labels[] = { "Bank-wide total", "Interest run" };
+    double doubleSeconds[2], moneySeconds[2];
+
+    auto started = chrono::steady_clock::now();
+    double doubleTotal = 0.0;
+    for (int pass = 0; pass < passes; pass++) {
+        doubleTotal = 0.0;
+        for (int i = 0; i < accounts; i++) {
+            doubleTotal += amounts[i];
         }
-        else {
-            cout << "Account " << accountNumber << " not found!" << endl;
+        benchmarkSink = doubleTotal;
+    }
+    doubleSeconds[0] = secondsSince(started);
+    started = chrono::steady_clock::now();
+    long long exactTotal = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        exactTotal = sumCents(cents.data(), cents.size());
+        benchmarkSink = static_cast<double>(exactTotal);
+    }
+    moneySeconds[0] = secondsSince(started);
+
+    started = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (int i = 0; i < accounts; i++) {
+            doubleInterest[i] = amounts[i] * doubleRates[i] * 30.0 / 365.0;
         }
+        benchmarkSink = doubleInterest[pass];
     }
+    doubleSeconds[1] = secondsSince(started);
+    started = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        computeInterest(cents.data(), rates.data(), days.data(), interest.data(), cents.size());
+        benchmarkSink = static_cast<double>(interest[pass]);
+    }
+    moneySeconds[1] = secondsSince(started);
 
-    void displayAccountTransactions(int accountNumber) {
-        Account* account = findAccount(accountNumber);
-        if (account) {
-            account->displayTransactions();
+    cout << "\n--- Money Kernels (" << accounts << " balances, " << passes << " passes) ---" << endl;
+    cout << formatString("Kernel", 18) << formatString("double ns/acct", 16) << formatString("Money ns/acct", 16) << "Speedup" << endl;
+    cout << formatLine(58) << endl;
+    for (int i = 0; i < 2; i++) {
+        double perAccount = 1e9 / (static_cast<double>(accounts) * passes);
+        cout << formatString(labels[i], 18) << formatString(formatDouble(doubleSeconds[i] * perAccount), 16)
+            << formatString(formatDouble(moneySeconds[i] * perAccount), 16)
+            << formatDouble(doubleSeconds[i] / moneySeconds[i]) << "x" << endl;
+    }
+    cout << "Exact total $" << Money::fromCents(exactTotal) << "; the double total is off by "
+        << llabs(llround(doubleTotal * 100.0) - exactTotal) << " cent(s)" << endl;
+}
+
+// Reconciles a synthetic book far larger than the bank's account table, at rising thread counts
+void benchmarkReconciliation() {
+    cout << "Number of accounts (0 for 10000): ";
+    int accountCount = getIntInput();
+    if (accountCount <= 0) {
+        accountCount = 10000;
+    }
+    vector<Account*> accounts;
+    {
+        QuietOutput quiet;
+        IdCounterGuard counters;
+        BenchmarkRandom random(35);
+        for (int i = 0; i < accountCount; i++) {
+            Customer customer("Recon Customer " + to_string(i), "", "", "0000");
+            accounts.push_back(new CurrentAccount(customer, Money::fromCents(1000000)));
         }
-        else {
-            cout << "Account " << accountNumber << " not found!" << endl;
+        long long operations = static_cast<long long>(accountCount) * 24;
+        for (long long i = 0; i < operations; i++) {
+            Account* account = accounts[random.nextInt(accountCount)];
+            Money amount = Money::fromCents(100 + random.nextInt(50000));
+            int kind = random.nextInt(4);
+            if (kind == 0) {
+                account->deposit(amount);
+            }
+            else if (kind == 1) {
+                account->withdraw(amount);
+            }
+            else {
+                Account* other = accounts[random.nextInt(accountCount)];
+                if (other != account) {
+                    Bank::postTransfer(account, other, amount);
+                }
+            }
         }
     }
+    BookSnapshots snapshots;
+    snapshots.rebuild("Reconciliation Benchmark", accounts.data(), accountCount, nullptr, 0);
+    shared_ptr<const BookImage> image = snapshots.acquire();
 
-    void displayAllAccounts() const {
-        if (accountCount == 0) {
-            cout << "No accounts found in the system!" << endl;
-            return;
-        }
-        cout << "\n--- All Accounts ---" << endl;
-        cout << formatString("Acc No.", 10) << " | ";
-        cout << formatString("Type", 10) << " | ";
-        cout << formatString("Customer Name", 20) << " | ";
-        cout << formatString("Balance", 12) << endl;
-        cout << formatLine(60) << endl;
-        for (int i = 0; i < accountCount; i++) {
-            cout << formatString(to_string(accounts[i]->getAccountNumber()), 10) << " | ";
-            cout << formatString(accounts[i]->getAccountType(), 10) << " | ";
-            cout << formatString(accounts[i]->getCustomer().getName(), 20) << " | ";
-            cout << formatString("$" + formatDouble(accounts[i]->getBalance()), 12) << endl;
+    int hardwareThreads = static_cast<int>(thread::hardware_concurrency());
+    vector<int> threadCounts = { 1 };
+    for (int threads = 2; threads <= max(hardwareThreads, 1); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (threadCounts.back() != hardwareThreads && hardwareThreads > 1) {
+        threadCounts.push_back(hardwareThreads);
+    }
+    NullBuffer sink;
+    ostream discard(&sink);
+    cout << "\n--- Reconciliation (" << accountCount << " accounts) ---" << endl;
+    for (int threads : threadCounts) {
+        ReconciliationStats stats;
+        ReportWriter out(discard);
+        Reconciler(threads).run(*image, out, stats);
+        cout << formatString(to_string(stats.threads) + " thread(s)", 12) << " | "
+            << formatString(to_string(stats.transactions) + " transactions", 22) << " | "
+            << formatString(formatDouble(stats.seconds * 1000.0) + " ms", 12) << " | "
+            << formatString(formatDouble(stats.transactionsPerSecond() / 1e6) + " M tx/sec", 16) << " | "
+            << stats.breaks() << " break(s), " << stats.unverified << " unverified" << endl;
+        if (threads == threadCounts.back() && stats.transactionsPerSecond() > 0) {
+            cout << "Projected time for 50M transactions: "
+                << formatDouble(50e6 / stats.transactionsPerSecond()) << " s" << endl;
         }
     }
+}
 
-    void applyInterestToAllSavings() {
-        bool appliedToAny = false;
-        for (int i = 0; i < accountCount; i++) {
-            SavingsAccount* savingsAccount = dynamic_cast<SavingsAccount*>(accounts[i]);
-            if (savingsAccount) {
-                savingsAccount->applyInterest();
-                appliedToAny = true;
-            }
+// Timer wheel against a binary heap for a large pending book, then due orders fired through the
+// bank's transfer rules over a simulated day
+void benchmarkStandingOrders() {
+    cout << "Number of pending orders (0 for 1000000): ";
+    int orderCount = getIntInput();
+    if (orderCount <= 0) {
+        orderCount = 1000000;
+    }
+    const long long horizon = 30 * SavingsAccount::SECONDS_PER_DAY;
+    const long long step = 60;
+    vector<long long> dueTicks(orderCount);
+    BenchmarkRandom random(37);
+    for (int i = 0; i < orderCount; i++) {
+        dueTicks[i] = 1 + random.nextInt(static_cast<int>(horizon));
+    }
+
+    cout << "\n--- Standing Order Scheduling (" << orderCount << " orders over 30 days, " << step << " s steps) ---" << endl;
+    cout << formatString("Structure", 14) << formatString("insert ns/order", 18) << formatString("fire ns/order", 16) << "Fired" << endl;
+    cout << formatLine(56) << endl;
+    double insertSeconds[2], fireSeconds[2];
+    long long firedCount[2] = { 0, 0 };
+    {
+        TimerWheel wheel(0);
+        auto started = chrono::steady_clock::now();
+        for (int i = 0; i < orderCount; i++) {
+            wheel.schedule(i, dueTicks[i]);
         }
-        if (appliedToAny) {
-            cout << "Interest applied to all savings accounts." << endl;
+        insertSeconds[0] = secondsSince(started);
+        vector<TimerWheel::Entry> fired;
+        started = chrono::steady_clock::now();
+        for (long long now = step; now <= horizon + step; now += step) {
+            fired.clear();
+            wheel.advance(now, fired);
+            firedCount[0] += static_cast<long long>(fired.size());
         }
-        else {
-            cout << "No savings accounts found to apply interest." << endl;
+        fireSeconds[0] = secondsSince(started);
+    }
+    {
+        priority_queue<pair<long long, int>, vector<pair<long long, int>>, greater<pair<long long, int>>> heap;
+        auto started = chrono::steady_clock::now();
+        for (int i = 0; i < orderCount; i++) {
+            heap.emplace(dueTicks[i], i);
         }
+        insertSeconds[1] = secondsSince(started);
+        started = chrono::steady_clock::now();
+        for (long long now = step; now <= horizon + step; now += step) {
+            while (!heap.empty() && heap.top().first <= now) {
+                heap.pop();
+                firedCount[1]++;
+            }
+        }
+        fireSeconds[1] = secondsSince(started);
+    }
+    const char* labels[] = { "Timer wheel", "Binary heap" };
+    for (int i = 0; i < 2; i++) {
+        cout << formatString(labels[i], 14) << formatString(formatDouble(insertSeconds[i] * 1e9 / orderCount), 18)
+            << formatString(formatDouble(fireSeconds[i] * 1e9 / orderCount), 16) << firedCount[i] << endl;
     }
 
-    void manageLoans() {
-        int accountNumber;
-        cout << "Enter account number: ";
-        accountNumber = getIntInput();
-        Account* account = findAccount(accountNumber);
-        if (!account) {
-            cout << "Account " << accountNumber << " not found!" << endl;
-            return;
+    const int bankOrders = 20000;
+    const long long day = SavingsAccount::SECONDS_PER_DAY;
+    vector<double> micros;
+    SchedulerStats stats;
+    {
+        QuietOutput quiet;
+        IdCounterGuard counters;
+        Bank bank("Benchmark Bank");
+        vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, Money::fromCents(100000000));
+        time_t base = time(nullptr);
+        int count = static_cast<int>(opened.size());
+        for (int i = 0; i < bankOrders; i++) {
+            int from = random.nextInt(count);
+            int to = (from + 1 + random.nextInt(count - 1)) % count;
+            bank.scheduleTransfer(opened[from]->getAccountNumber(), opened[to]->getAccountNumber(),
+                Money::fromCents(100 + random.nextInt(10000)), base + random.nextInt(static_cast<int>(day)),
+                i % 4 == 0 ? 3600 : 0);
         }
-        string pin = getPinInput();
-        if (!verifyCustomerPin(accountNumber, pin)) {
-            return;
+        for (long long now = base + step; now <= base + day; now += step) {
+            auto started = chrono::steady_clock::now();
+            bank.runDueTransfers(static_cast<time_t>(now));
+            micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - started).count());
         }
-        int choice;
-        cout << "\n--- Loan Management ---" << endl;
-        cout << "1. Apply for a Loan" << endl;
-        cout << "2. View Loan Details" << endl;
-        cout << "3. Make Loan Payment" << endl;
-        cout << "4. Back to Main Menu" << endl;
-        cout << "Enter choice (1-4): ";
-        choice = getIntInput();
-        if (choice == 1) {
-            int custID = account->getCustomer().getCustomerID();
-            for (int i = 0; i < loanCount; i++) {
-                if (loans[i] && loans[i]->getCustomerID() == custID && loans[i]->isActive()) {
-                    cout << "Customer already has an active loan!" << endl;
-                    return;
+        stats = bank.getScheduler().getStats();
+    }
+    cout << "\n--- Due Orders Through the Bank (" << bankOrders << " orders, 1 simulated day) ---" << endl;
+    cout << "Fired " << stats.fired << " in " << stats.batches << " batch(es): " << stats.executed << " executed, "
+        << stats.failed << " refused by transfer rules" << endl;
+    cout << "Firing throughput: " << formatDouble(stats.firedPerSecond()) << " orders/sec" << endl;
+    cout << "Lag behind due time: average " << formatDouble(stats.averageLagSeconds()) << " s, max "
+        << formatDouble(stats.maxLagSeconds) << " s (bounded by the " << step << " s polling step)" << endl;
+    reportLatency("Batch latency", micros);
+}
+
+// Skewed deposit load: nine in ten deposits go to one merchant account, the rest are spread over the
+// book. Runs each thread count with the merchant as a normal account and as a hot split account.
+void benchmarkHotAccount() {
+    const double phaseSeconds = 1.0;
+    const Money opening = Money::fromCents(10000000);
+    int hardwareThreads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    vector<int> threadCounts;
+    for (int threads = 1; threads <= max(hardwareThreads, 4); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    cout << "\n--- Skewed Deposits to One Hot Account (" << phaseSeconds << "s per phase, "
+        << hardwareThreads << " hardware threads) ---" << endl;
+    cout << formatString("Threads", 9) << formatString("Normal deposits/sec", 22)
+        << formatString("Split deposits/sec", 22) << "Speedup" << endl;
+    cout << formatLine(62) << endl;
+    bool exact = true;
+    for (int threads : threadCounts) {
+        double rates[2];
+        for (int mode = 0; mode < 2; mode++) {
+            atomic<long long> operations(0), hotCents(0);
+            Money hotBalance;
+            {
+                QuietOutput quiet;
+                IdCounterGuard counters;
+                Bank bank("Benchmark Bank");
+                vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, opening);
+                Account* merchant = opened[1];
+                if (mode == 1) {
+                    bank.setAccountHot(merchant->getAccountNumber(), true, threads);
                 }
+                atomic<bool> stop(false);
+                vector<thread> workers;
+                for (int t = 0; t < threads; t++) {
+                    workers.emplace_back([&, t] {
+                        BenchmarkRandom random(38 + t);
+                        int count = static_cast<int>(opened.size());
+                        long long done = 0, toMerchant = 0;
+                        while (!stop.load(memory_order_relaxed)) {
+                            for (int i = 0; i < 64; i++) {
+                                Money amount = Money::fromCents(100 + random.nextInt(900));
+                                if (random.nextInt(10) != 0) {
+                                    bank.executeDeposit(merchant, amount);
+                                    toMerchant += amount.getCents();
+                                }
+                                else {
+                                    int other = random.nextInt(count - 1);
+                                    bank.executeDeposit(opened[other >= 1 ? other + 1 : other], amount);
+                                }
+                            }
+                            done += 64;
+                        }
+                        operations += done;
+                        hotCents += toMerchant;
+                    });
+                }
+                this_thread::sleep_for(chrono::duration<double>(phaseSeconds));
+                stop = true;
+                for (thread& worker : workers) {
+                    worker.join();
+                }
+                bank.foldAllHotCredits();
+                hotBalance = merchant->getBalance();
             }
-            double principal;
-            int duration;
-            cout << "Enter loan amount ($1000-$50000): $";
-            principal = getDoubleInput();
-            if (principal < 1000 || principal > 50000) {
-                cout << "Loan amount must be between $1000 and $50000!" << endl;
-                return;
-            }
-            if (principal > 5 * account->getBalance()) {
-                cout << "Loan rejected! Amount exceeds 5x account balance ($"
-                    << formatDouble(account->getBalance()) << ")." << endl;
-                return;
-            }
-            cout << "Enter loan duration (12-60 months): ";
-            duration = getIntInput();
-            if (duration < 12 || duration > 60) {
-                cout << "Duration must be between 12 and 60 months!" << endl;
-                return;
-            }
-            if (loanCount >= MAX_LOANS) {
-                cout << "Maximum number of loans reached!" << endl;
-                return;
-            }
-            loans[loanCount] = new Loan(custID, principal, 0.05, duration);
-            account->deposit(principal);
-            Transaction transaction("Loan Disbursement", principal, accountNumber);
-            account->addTransaction(transaction);
-            cout << "Loan approved! $" << formatDouble(principal) << " deposited to account "
-                << accountNumber << endl;
-            loans[loanCount]->display();
-            loanCount++;
+            rates[mode] = operations / phaseSeconds;
+            exact = exact && hotBalance.getCents() == opening.getCents() + hotCents.load();
         }
-        else if (choice == 2) {
-            int loanID;
-            cout << "Enter loan ID: ";
-            loanID = getIntInput();
-            for (int i = 0; i < loanCount; i++) {
-                if (loans[i] && loans[i]->getLoanID() == loanID) {
-                    loans[i]->display();
-                    return;
-                }
+        cout << formatString(to_string(threads), 9) << formatString(formatDouble(rates[0]), 22)
+            << formatString(formatDouble(rates[1]), 22) << formatDouble(rates[1] / rates[0]) << "x" << endl;
+    }
+    cout << "Merchant balances after folding: " << (exact ? "every credit accounted for" : "MISMATCH") << endl;
+}
+
+// Whole-portfolio projection: the columnar amortizeMonth engine against stepping one loan object at a
+// time, then the engine again with every schedule streamed in columnar form to a discarding sink
+void benchmarkAmortization() {
+    cout << "Number of loans (0 for 1000000): ";
+    int loanCount = getIntInput();
+    if (loanCount <= 0) {
+        loanCount = 1000000;
+    }
+    const int months = 60;
+    vector<Loan> portfolio;
+    portfolio.reserve(loanCount);
+    {
+        QuietOutput quiet;
+        IdCounterGuard counters;
+        BenchmarkRandom random(39);
+        for (int i = 0; i < loanCount; i++) {
+            Loan loan(1000 + i, Money::fromCents(100000 + random.nextInt(4900001)),
+                0.05 + random.nextInt(8) / 100.0, 12 + random.nextInt(49));
+            int paidMonths = random.nextInt(12);
+            for (int m = 0; m < paidMonths; m++) {
+                loan.makePayment(loan.getMonthlyPayment());
             }
-            cout << "Loan " << loanID << " not found!" << endl;
+            portfolio.push_back(loan);
         }
-        else if (choice == 3) {
-            int loanID;
-            double amount;
-            cout << "Enter loan ID: ";
-            loanID = getIntInput();
-            Loan* loan = nullptr;
-            for (int i = 0; i < loanCount; i++) {
-                if (loans[i] && loans[i]->getLoanID() == loanID) {
-                    loan = loans[i];
-                    break;
-                }
+    }
+
+    vector<long long> rowInterest(months, 0), rowOutstanding(months, 0);
+    auto started = chrono::steady_clock::now();
+    for (const Loan& loan : portfolio) {
+        Money remaining = loan.getRemainingBalance();
+        Money instalment = loan.getMonthlyPayment();
+        long long total = loan.getTotalRepayable().getCents();
+        long long totalInterest = total - loan.getPrincipal().getCents();
+        for (int m = 0; m < months; m++) {
+            Money paid = remaining < instalment ? remaining : instalment;
+            Money interest = Money::fromCents(paid.getCents() * totalInterest).dividedBy(total);
+            remaining -= paid;
+            rowInterest[m] += interest.getCents();
+            rowOutstanding[m] += remaining.getCents();
+        }
+    }
+    double rowSeconds = secondsSince(started);
+
+    NullBuffer sink;
+    ostream discard(&sink);
+    started = chrono::steady_clock::now();
+    AmortizationEngine engine;
+    for (const Loan& loan : portfolio) {
+        engine.addLoan(loan);
+    }
+    double setupSeconds = secondsSince(started);
+    double projectSeconds[2];
+    vector<PortfolioMonth> totals[2];
+    for (int run = 0; run < 2; run++) {
+        started = chrono::steady_clock::now();
+        engine.project(months, totals[run], run == 1 ? &discard : nullptr);
+        projectSeconds[run] = secondsSince(started);
+    }
+    bool match = true;
+    for (int m = 0; m < months; m++) {
+        match = match && totals[0][m].interest.getCents() == rowInterest[m]
+            && totals[0][m].outstanding.getCents() == rowOutstanding[m]
+            && totals[1][m].interest.getCents() == rowInterest[m];
+    }
+
+    double loanMonths = static_cast<double>(loanCount) * months;
+    cout << "\n--- Loan Portfolio Projection (" << loanCount << " loans, " << months << " months) ---" << endl;
+    cout << formatString("Method", 24) << formatString("Project ms", 14) << "ns/loan-month" << endl;
+    cout << formatLine(52) << endl;
+    cout << formatString("Loan at a time", 24) << formatString(formatDouble(rowSeconds * 1000), 14)
+        << formatDouble(rowSeconds * 1e9 / loanMonths) << endl;
+    const char* labels[] = { "Columnar kernel", "Kernel + columnar out" };
+    for (int run = 0; run < 2; run++) {
+        cout << formatString(labels[run], 24) << formatString(formatDouble(projectSeconds[run] * 1000), 14)
+            << formatDouble(projectSeconds[run] * 1e9 / loanMonths) << endl;
+    }
+    cout << "Engine setup (per-loan precompute): " << formatDouble(setupSeconds * 1000) << " ms" << endl;
+    cout << "Kernel speedup over loan at a time: " << formatDouble(rowSeconds / projectSeconds[0]) << "x" << endl;
+    cout << "Portfolio totals " << (match ? "match the loan-at-a-time schedule" : "MISMATCH the loan-at-a-time schedule") << endl;
+}
+
+// Client workflows of several operations on one account, each operation authorized by PIN against
+// one sign-in followed by session tokens; then the expiry sweep for a large number of lapsed sessions
+void benchmarkSessions() {
+    const int workflows = 20000;
+    const int operationsPerWorkflow = 10;
+    const Money opening = Money::fromCents(100000000);
+    double seconds[2], authSeconds[2];
+    long long refused[2] = { 0, 0 };
+    for (int mode = 0; mode < 2; mode++) {
+        QuietOutput quiet;
+        IdCounterGuard counters;
+        Bank bank("Benchmark Bank");
+        vector<Account*> opened = populateBenchmarkBank(bank, MAX_ACCOUNTS, opening);
+        BenchmarkRandom random(40);
+        int count = static_cast<int>(opened.size());
+        authSeconds[mode] = 0.0;
+        auto started = chrono::steady_clock::now();
+        for (int w = 0; w < workflows; w++) {
+            Account* account = opened[random.nextInt(count)];
+            int accountNumber = account->getAccountNumber();
+            string credential = account->getCustomer().getPin();
+            if (mode == 1) {
+                credential = bank.signIn(accountNumber, credential);
             }
-            if (!loan) {
-                cout << "Loan " << loanID << " not found!" << endl;
-                return;
+            for (int op = 0; op < operationsPerWorkflow; op++) {
+                auto checked = chrono::steady_clock::now();
+                bool allowed = bank.authorize(accountNumber, credential);
+                authSeconds[mode] += secondsSince(checked);
+                if (!allowed) {
+                    refused[mode]++;
+                    continue;
+                }
+                Money amount = Money::fromCents(100 + random.nextInt(900));
+                if (op % 2 == 0) {
+                    bank.executeDeposit(account, amount);
+                }
+                else {
+                    bank.executeWithdrawal(account, amount);
+                }
             }
-            cout << "Enter payment amount: $";
-            amount = getDoubleInput();
-            loan->makePayment(amount);
-            if (!loan->isActive()) {
-                cout << "Loan fully repaid!" << endl;
+            if (mode == 1) {
+                bank.signOut(credential);
             }
         }
-        else if (choice == 4) {
-            return;
-        }
-        else {
-            cout << "Invalid choice!" << endl;
-        }
+        seconds[mode] = secondsSince(started);
+    }
+    double operations = static_cast<double>(workflows) * operationsPerWorkflow;
+    cout << "\n--- Session Workflows (" << workflows << " workflows x " << operationsPerWorkflow << " operations) ---" << endl;
+    cout << formatString("Authorization", 18) << formatString("Workflows/sec", 16) << formatString("Ops/sec", 14)
+        << "Auth ns/op" << endl;
+    cout << formatLine(58) << endl;
+    const char* labels[] = { "PIN every time", "Session token" };
+    for (int mode = 0; mode < 2; mode++) {
+        cout << formatString(labels[mode], 18) << formatString(formatDouble(workflows / seconds[mode]), 16)
+            << formatString(formatDouble(operations / seconds[mode]), 14)
+            << formatDouble(authSeconds[mode] * 1e9 / operations) << endl;
     }
+    cout << "Refused: " << refused[0] << " with PINs, " << refused[1] << " with sessions" << endl;
 
-    void saveToFile(const string& filename) const {
-        ofstream outFile(filename);
-        if (!outFile) {
-            cerr << "Error opening file for writing!" << endl;
-            return;
-        }
-        outFile << bankName << endl;
-        outFile << accountCount << endl;
-        outFile << Account::getNextAccountNumber() << endl;
-        outFile << Customer::getNextCustomerID() << endl;
-        outFile << Transaction::getNextTransactionID() << endl;
-        outFile << loanCount << endl;
-        outFile << Loan::getNextLoanID() << endl;
-        for (int i = 0; i < accountCount; i++) {
-            outFile << accounts[i]->getAccountType() << endl;
-            accounts[i]->saveToFile(outFile);
-        }
-        for (int i = 0; i < loanCount; i++) {
-            loans[i]->saveToFile(outFile);
+    const int sessionCount = 200000;
+    SessionManager manager(0);
+    manager.setTimeout(60);
+    auto started = chrono::steady_clock::now();
+    for (int i = 0; i < sessionCount; i++) {
+        manager.open(100 + i % MAX_ACCOUNTS, static_cast<time_t>(i * 600LL / sessionCount));
+    }
+    manager.expire(700);
+    double lifecycleSeconds = secondsSince(started);
+    cout << "\n--- Session Expiry (" << sessionCount << " sessions opened over 10 minutes, 60 s idle timeout) ---" << endl;
+    cout << "Open and expire: " << formatDouble(lifecycleSeconds * 1e9 / sessionCount) << " ns/session; "
+        << manager.getStats().expired << " lapsed, " << manager.size() << " still live" << endl;
+}
+
+// Transaction history in the save file's text layout against the compact archive: size on disk,
+// write throughput and read-back throughput, with the archive's round trip checked entry by entry
+void benchmarkHistoryArchive() {
+    cout << "Number of history entries (0 for 1000000): ";
+    int entryCount = getIntInput();
+    if (entryCount <= 0) {
+        entryCount = 1000000;
+    }
+    const char* types[] = { "Deposit", "Withdrawal", "Transfer", "Interest", "Loan Disbursement" };
+    vector<pair<int, Transaction>> history;
+    history.reserve(entryCount);
+    BenchmarkRandom random(41);
+    time_t when = time(nullptr) - 365 * SavingsAccount::SECONDS_PER_DAY;
+    int owner = 100;
+    for (int i = 0; i < entryCount; i++) {
+        if (i % MAX_TRANSACTIONS == 0) {
+            owner++;
         }
-        outFile.close();
-        cout << "Data saved successfully to " << filename << endl;
+        when += random.nextInt(300);
+        int kind = random.nextInt(20);
+        const char* type = types[kind < 9 ? 0 : kind < 16 ? 1 : kind < 18 ? 2 : kind < 19 ? 3 : 4];
+        int toAccount = kind == 16 || kind == 17 ? 100 + random.nextInt(MAX_ACCOUNTS) : -1;
+        history.emplace_back(owner, Transaction(10000 + i, formatDateTime(when), type,
+            Money::fromCents(100 + random.nextInt(500000)), owner, toAccount));
     }
+    filesystem::path directory = filesystem::temp_directory_path();
+    string textFile = (directory / "bank_history_benchmark.txt").string();
+    string archiveFile = (directory / "bank_history_benchmark.bkha").string();
 
-    void loadFromFile(const string& filename) {
-        ifstream inFile(filename);
-        if (!inFile) {
-            cerr << "Error opening file for reading!" << endl;
-            return;
+    auto started = chrono::steady_clock::now();
+    {
+        ofstream outFile(textFile, ios::binary);
+        for (const auto& entry : history) {
+            entry.second.saveToFile(outFile);
         }
-        for (int i = 0; i < accountCount; i++) {
-            delete accounts[i];
-            accounts[i] = nullptr;
+    }
+    double textWriteSeconds = secondsSince(started);
+    started = chrono::steady_clock::now();
+    long long textRead = 0;
+    {
+        ifstream inFile(textFile, ios::binary);
+        InputScanner in(inFile);
+        Transaction transaction;
+        while (textRead < entryCount && transaction.loadFromFile(in)) {
+            textRead++;
         }
-        for (int i = 0; i < loanCount; i++) {
-            delete loans[i];
-            loans[i] = nullptr;
+    }
+    double textReadSeconds = secondsSince(started);
+
+    started = chrono::steady_clock::now();
+    {
+        ofstream outFile(archiveFile, ios::binary);
+        HistoryArchiveWriter writer(outFile);
+        for (const auto& entry : history) {
+            writer.add(entry.first, entry.second);
         }
-        accountCount = 0;
-        loanCount = 0;
-        getline(inFile, bankName);
-        inFile >> accountCount;
-        int nextAccNum, nextCustID, nextTransID, nextLoanID;
-        inFile >> nextAccNum;
-        inFile >> nextCustID;
-        inFile >> nextTransID;
-        inFile >> loanCount;
-        inFile >> nextLoanID;
-        Account::setNextAccountNumber(nextAccNum);
-        Customer::setNextCustomerID(nextCustID);
-        Transaction::setNextTransactionID(nextTransID);
-        Loan::setNextLoanID(nextLoanID);
-        inFile.ignore();
-        for (int i = 0; i < accountCount; i++) {
-            string accountType;
-            getline(inFile, accountType);
-            if (accountType == "Savings") {
-                accounts[i] = new SavingsAccount(Customer("", "", ""), 0.0);
+        writer.finish();
+    }
+    double archiveWriteSeconds = secondsSince(started);
+    started = chrono::steady_clock::now();
+    long long archiveRead = 0, mismatches = 0;
+    string error;
+    {
+        ifstream inFile(archiveFile, ios::binary);
+        HistoryArchiveReader reader(inFile);
+        vector<ArchivedTransaction> entries;
+        while (reader.nextBlock(entries)) {
+            for (const ArchivedTransaction& entry : entries) {
+                const Transaction& original = history[archiveRead++].second;
+                mismatches += entry.transactionID != original.getTransactionID() || entry.dateTime != original.getDateTime()
+                    || *entry.type != original.getType() || entry.amount != original.getAmount()
+                    || entry.fromAccount != original.getFromAccount() || entry.toAccount != original.getToAccount();
             }
-            else if (accountType == "Current") {
-                accounts[i] = new CurrentAccount(Customer("", "", ""), 0.0);
+        }
+        error = reader.getError();
+    }
+    double archiveReadSeconds = secondsSince(started);
+
+    double textBytes = static_cast<double>(filesystem::file_size(textFile));
+    double archiveBytes = static_cast<double>(filesystem::file_size(archiveFile));
+    filesystem::remove(textFile);
+    filesystem::remove(archiveFile);
+    cout << "\n--- Transaction History Archive (" << entryCount << " entries) ---" << endl;
+    cout << formatString("Format", 16) << formatString("Bytes/entry", 14) << formatString("Write MB/s", 13)
+        << formatString("Write entries/s", 18) << "Read entries/s" << endl;
+    cout << formatLine(76) << endl;
+    cout << formatString("Save-file text", 16) << formatString(formatDouble(textBytes / entryCount), 14)
+        << formatString(formatDouble(textBytes / 1048576.0 / textWriteSeconds), 13)
+        << formatString(formatDouble(entryCount / textWriteSeconds), 18) << formatDouble(textRead / textReadSeconds) << endl;
+    cout << formatString("Archive", 16) << formatString(formatDouble(archiveBytes / entryCount), 14)
+        << formatString(formatDouble(archiveBytes / 1048576.0 / archiveWriteSeconds), 13)
+        << formatString(formatDouble(entryCount / archiveWriteSeconds), 18) << formatDouble(archiveRead / archiveReadSeconds) << endl;
+    cout << "Archive is " << formatDouble(textBytes / archiveBytes) << "x smaller; writes "
+        << formatDouble(textWriteSeconds / archiveWriteSeconds) << "x and reads "
+        << formatDouble(textReadSeconds / archiveReadSeconds) << "x faster" << endl;
+    if (!error.empty() || archiveRead != entryCount || mismatches > 0) {
+        cout << "Warning: archive round trip failed (" << archiveRead << " read, " << mismatches << " mismatched"
+            << (error.empty() ? "" : ", " + error) << ")" << endl;
+    }
+    else {
+        cout << "Round trip: every entry read back identical" << endl;
+    }
+}
+
+void runBenchmarks() {
+    int choice;
+    cout << "\n--- Performance Benchmarks ---" << endl;
+    cout << "1. Velocity Check Overhead" << endl;
+    cout << "2. Point-in-Time Queries vs. Checkpoint Interval" << endl;
+    cout << "3. Write Throughput Under Concurrent Reports" << endl;
+    cout << "4. Deposit Latency With Background Checkpoints" << endl;
+    cout << "5. Bulk File Parsing" << endl;
+    cout << "6. Money Kernels vs. Double Arithmetic" << endl;
+    cout << "7. Reconciliation Throughput" << endl;
+    cout << "8. Standing Order Scheduler" << endl;
+    cout << "9. Hot Account Split Balances" << endl;
+    cout << "10. Loan Portfolio Projection" << endl;
+    cout << "11. Session Authorization" << endl;
+    cout << "12. Transaction History Archive" << endl;
+    cout << "13. Back to Main Menu" << endl;
+    cout << "Enter choice (1-13): ";
+    choice = getIntInput();
+    if (choice == 1) {
+        benchmarkVelocityChecks();
+    }
+    else if (choice == 2) {
+        benchmarkPointInTimeQueries();
+    }
+    else if (choice == 3) {
+        benchmarkSnapshotReads();
+    }
+    else if (choice == 4) {
+        benchmarkBackgroundCheckpoints();
+    }
+    else if (choice == 5) {
+        benchmarkBulkParsing();
+    }
+    else if (choice == 6) {
+        benchmarkMoneyKernels();
+    }
+    else if (choice == 7) {
+        benchmarkReconciliation();
+    }
+    else if (choice == 8) {
+        benchmarkStandingOrders();
+    }
+    else if (choice == 9) {
+        benchmarkHotAccount();
+    }
+    else if (choice == 10) {
+        benchmarkAmortization();
+    }
+    else if (choice == 11) {
+        benchmarkSessions();
+    }
+    else if (choice == 12) {
+        benchmarkHistoryArchive();
+    }
+    else if (choice != 13) {
+        cout << "Invalid choice!" << endl;
+    }
+}
+
+// Replays a captured trace against a fresh bank loaded from the book saved when capture started.
+// Each operation runs with the bank clock pinned to its captured time, so interest and expiry come
+// out as they did live. Unpaced, operations run back to back (time-compressed); paced, each waits
+// for its original arrival offset. Returns true when every outcome and the closing book match.
+bool replayTrace(const string& traceFile, const string& bookFile, bool paced) {
+    TraceReader reader;
+    if (!reader.open(traceFile)) {
+        cout << "Replay failed: " << reader.getError() << endl;
+        return false;
+    }
+    // The scratch bank's load and opens must not move the live bank's ID counters
+    IdCounterGuard counters;
+    unique_ptr<Bank> bank;
+    vector<double> micros;
+    long long divergences = 0;
+    double seconds = 0;
+    bool loaded;
+    TraceRecord record;
+    {
+        QuietOutput quiet;
+        bank.reset(new Bank("Replay Bank"));
+        // Load as of the capture's start, so the scheduler and journal begin where they did live
+        pinnedClock.store(static_cast<long long>(reader.getStartTime()), memory_order_relaxed);
+        loaded = bank->loadFromFile(bookFile);
+        if (loaded) {
+            auto started = chrono::steady_clock::now();
+            while (reader.next(record)) {
+                if (paced) {
+                    this_thread::sleep_until(started + chrono::microseconds(record.atMicros));
+                }
+                pinnedClock.store(static_cast<long long>(record.when), memory_order_relaxed);
+                auto operationStarted = chrono::steady_clock::now();
+                bool applied = bank->replayOperation(record);
+                micros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - operationStarted).count());
+                if (applied != record.applied) {
+                    divergences++;
+                }
             }
-            else {
-                cerr << "Unknown account type: " << accountType << endl;
-                continue;
+            seconds = secondsSince(started);
+        }
+        pinnedClock.store(0, memory_order_relaxed);
+    }
+    if (!loaded) {
+        cout << "Replay failed: cannot load starting book " << bookFile << endl;
+        return false;
+    }
+    if (!reader.getError().empty()) {
+        cout << "Replay stopped after " << micros.size() << " operation(s): " << reader.getError() << endl;
+        return false;
+    }
+    cout << "\n--- Replay of " << traceFile << (paced ? " (paced)" : " (time-compressed)") << " ---" << endl;
+    cout << "Operations: " << micros.size() << " in " << formatDouble(seconds * 1000.0) << " ms";
+    if (seconds > 0) {
+        cout << " (" << formatDouble(micros.size() / seconds) << " ops/sec)";
+    }
+    cout << endl;
+    if (!micros.empty()) {
+        reportLatency("Operation latency", micros);
+    }
+    cout << "Outcome divergences: " << divergences << endl;
+
+    // After the last record, record.when is the capture's closing clock
+    pinnedClock.store(static_cast<long long>(record.when), memory_order_relaxed);
+    vector<pair<int, Money>> balances, loanBalances;
+    bank->traceBook(balances, loanBalances, record.when);
+    pinnedClock.store(0, memory_order_relaxed);
+    int mismatches = 0;
+    auto compare = [&](const char* kind, const vector<pair<int, Money>>& expected, const vector<pair<int, Money>>& actual) {
+        map<int, Money> replayed(actual.begin(), actual.end());
+        for (const pair<int, Money>& entry : expected) {
+            auto found = replayed.find(entry.first);
+            if (found == replayed.end() || found->second != entry.second) {
+                if (++mismatches <= 10) {
+                    cout << "  " << kind << " " << entry.first << ": captured $" << entry.second << ", replayed "
+                        << (found == replayed.end() ? string("missing") : "$" + found->second.toString()) << endl;
+                }
             }
-            if (accounts[i]) {
-                accounts[i]->loadFromFile(inFile);
+            if (found != replayed.end()) {
+                replayed.erase(found);
             }
         }
-        for (int i = 0; i < loanCount; i++) {
-            loans[i] = new Loan();
-            loans[i]->loadFromFile(inFile);
+        for (const auto& extra : replayed) {
+            if (++mismatches <= 10) {
+                cout << "  " << kind << " " << extra.first << ": not in the captured book, replayed $" << extra.second << endl;
+            }
         }
-        inFile.close();
-        cout << "Data loaded successfully from " << filename << endl;
+    };
+    compare("Account", reader.getExpectedBalances(), balances);
+    compare("Loan", reader.getExpectedLoans(), loanBalances);
+    if (mismatches > 10) {
+        cout << "  ... " << mismatches - 10 << " more mismatch(es) not shown" << endl;
     }
-};
+    cout << "Final book: " << (mismatches == 0 ? "matches the captured book" : to_string(mismatches) + " mismatch(es)") << endl;
+    return divergences == 0 && mismatches == 0;
+}
+
+void captureAndReplay(Bank& bank) {
+    int choice;
+    cout << "\n--- Traffic Capture & Replay ---" << endl;
+    cout << "Capture is " << (bank.isCapturing() ? "running" : "stopped") << endl;
+    cout << "1. Start Capture" << endl;
+    cout << "2. Stop Capture" << endl;
+    cout << "3. Replay a Trace" << endl;
+    cout << "4. Back to Main Menu" << endl;
+    cout << "Enter choice (1-4): ";
+    choice = getIntInput();
+    if (choice == 1) {
+        string filename;
+        cout << "Enter trace filename: ";
+        clearInputBuffer();
+        getline(cin, filename);
+        bank.startCapture(filename);
+    }
+    else if (choice == 2) {
+        bank.stopCapture();
+    }
+    else if (choice == 3) {
+        string traceFile, bookFile, answer;
+        cout << "Enter trace filename: ";
+        clearInputBuffer();
+        getline(cin, traceFile);
+        cout << "Enter starting book filename (blank for " << traceFile << ".book): ";
+        getline(cin, bookFile);
+        cout << "Keep the original pacing? (y/n): ";
+        getline(cin, answer);
+        replayTrace(traceFile, bookFile.empty() ? traceFile + ".book" : bookFile, answer == "y" || answer == "Y");
+    }
+    else if (choice != 4) {
+        cout << "Invalid choice!" << endl;
+    }
+}
 
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
     Bank bank("OOP Banking System");
+    if (argc == 3 && string(argv[1]) == "--batch") {
+        bank.runBatchFile(argv[2], true);
+        if (bank.isCapturing()) {
+            bank.stopCapture();
+        }
+        return 0;
+    }
+    if (argc == 3 && (string(argv[1]) == "--replay" || string(argv[1]) == "--replay-paced")) {
+        string traceFile = argv[2];
+        return replayTrace(traceFile, traceFile + ".book", string(argv[1]) == "--replay-paced") ? 0 : 1;
+    }
     int choice;
     bool running = true;
 
     while (running) {
+        int executed = bank.runDueTransfers(currentTime());
+        if (executed > 0) {
+            cout << executed << " standing order(s) executed." << endl;
+        }
+        bank.expireSessions(currentTime());
         cout << "\n=== OOP Banking System ===" << endl;
         cout << "1. Create New Account" << endl;
         cout << "2. Display Account Details" << endl;
@@ -995,12 +8038,29 @@ int main() {
         cout << "6. Close an Account" << endl;
         cout << "7. Display All Accounts" << endl;
         cout << "8. Display Transaction History" << endl;
-        cout << "9. Apply Interest to Savings Accounts" << endl;
+        cout << "9. Post Month-End Interest" << endl;
         cout << "10. Save Data to File" << endl;
         cout << "11. Load Data from File" << endl;
         cout << "12. Manage Loans" << endl;
+        cout << "13. Sorted Listings & Search" << endl;
+        cout << "14. Export Accounts/Transactions" << endl;
+        cout << "15. Generate Month-End Statements" << endl;
+        cout << "16. Velocity Limits" << endl;
+        cout << "17. System Statistics" << endl;
+        cout << "18. Run Performance Benchmarks" << endl;
+        cout << "19. Point-in-Time Balances" << endl;
+        cout << "20. Book Summary Report" << endl;
+        cout << "21. Background Checkpointing" << endl;
+        cout << "22. Run Batch Command File" << endl;
+        cout << "23. Reconcile Books" << endl;
+        cout << "24. Standing Orders" << endl;
+        cout << "25. Hot Accounts" << endl;
+        cout << "26. Loan Portfolio Projection" << endl;
+        cout << "27. Sessions" << endl;
+        cout << "28. Memory Footprint" << endl;
+        cout << "29. Traffic Capture & Replay" << endl;
         cout << "0. Exit" << endl;
-        cout << "Enter your choice (0-12): ";
+        cout << "Enter your choice (0-29): ";
 
         choice = getIntInput();
 
@@ -1015,31 +8075,31 @@ int main() {
         }
         else if (choice == 3) {
             int accountNumber;
-            double amount;
+            Money amount;
             cout << "Enter account number: ";
             accountNumber = getIntInput();
             cout << "Enter deposit amount: $";
-            amount = getDoubleInput();
+            amount = getMoneyInput();
             bank.depositToAccount(accountNumber, amount);
         }
         else if (choice == 4) {
             int accountNumber;
-            double amount;
+            Money amount;
             cout << "Enter account number: ";
             accountNumber = getIntInput();
             cout << "Enter withdrawal amount: $";
-            amount = getDoubleInput();
+            amount = getMoneyInput();
             bank.withdrawFromAccount(accountNumber, amount);
         }
         else if (choice == 5) {
             int fromAcc, toAcc;
-            double amount;
+            Money amount;
             cout << "Enter source account number: ";
             fromAcc = getIntInput();
             cout << "Enter destination account number: ";
             toAcc = getIntInput();
             cout << "Enter transfer amount: $";
-            amount = getDoubleInput();
+            amount = getMoneyInput();
             bank.transferBetweenAccounts(fromAcc, toAcc, amount);
         }
         else if (choice == 6) {
@@ -1058,7 +8118,7 @@ int main() {
             bank.displayAccountTransactions(accountNumber);
         }
         else if (choice == 9) {
-            bank.applyInterestToAllSavings();
+            bank.postMonthEndInterest();
         }
         else if (choice == 10) {
             string filename;
@@ -1077,7 +8137,61 @@ int main() {
         else if (choice == 12) {
             bank.manageLoans();
         }
+        else if (choice == 13) {
+            bank.browseAccounts();
+        }
+        else if (choice == 14) {
+            bank.exportData();
+        }
+        else if (choice == 15) {
+            bank.generateStatements();
+        }
+        else if (choice == 16) {
+            bank.configureVelocityLimits();
+        }
+        else if (choice == 17) {
+            bank.displayStats();
+        }
+        else if (choice == 18) {
+            runBenchmarks();
+        }
+        else if (choice == 19) {
+            bank.pointInTimeBalances();
+        }
+        else if (choice == 20) {
+            bank.displayBookSummary();
+        }
+        else if (choice == 21) {
+            bank.configureCheckpointing();
+        }
+        else if (choice == 22) {
+            bank.runBatchFromMenu();
+        }
+        else if (choice == 23) {
+            bank.reconcileBooks();
+        }
+        else if (choice == 24) {
+            bank.manageStandingOrders();
+        }
+        else if (choice == 25) {
+            bank.configureHotAccounts();
+        }
+        else if (choice == 26) {
+            bank.projectLoanPortfolio();
+        }
+        else if (choice == 27) {
+            bank.manageSessions();
+        }
+        else if (choice == 28) {
+            bank.displayMemoryReport();
+        }
+        else if (choice == 29) {
+            captureAndReplay(bank);
+        }
         else if (choice == 0) {
+            if (bank.isCapturing()) {
+                bank.stopCapture();
+            }
             cout << "Thank you for using OOP Banking System. Goodbye!" << endl;
             running = false;
         }
@@ -0,0 +1,106 @@
+#!/bin/sh
+# Regression checks for banking_system.cpp. Each case drives the program through a batch file
+# (and, where needed, its command-line modes) and looks for the expected summary line.
+# Usage: tests/regression.sh [path/to/banking_system.cpp]
+SOURCE=${1:-$(dirname "$0")/../banking_system.cpp}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+BANK="$WORK/bank"
+FAILED=0
+
+if ! g++ -std=c++17 -O2 -pthread -o "$BANK" "$SOURCE"; then
+    echo "FAIL: build"
+    exit 1
+fi
+
+# check <name> <expected text> <output>
+check() {
+    if printf '%s\n' "$3" | grep -qF -- "$2"; then
+        echo "PASS: $1"
+    else
+        echo "FAIL: $1 (expected \"$2\")"
+        printf '%s\n' "$3" | sed 's/^/    /'
+        FAILED=1
+    fi
+}
+
+# A hot savings account must fold its stripes for a debit its minimum balance would otherwise refuse
+cat > "$WORK/hot_minimum.txt" <<EOF
+open savings 600 1111 Hot Saver
+hot 100 on
+deposit 100 1000 1111
+withdraw 100 200 1111
+EOF
+check "hot savings withdrawal folds stripes before the minimum-balance check" \
+    "4 command(s), 4 succeeded, 0 rejected, 0 malformed" \
+    "$(cd "$WORK" && "$BANK" --batch hot_minimum.txt 2>&1)"
+
+# Point-in-time queries date a hot account's stripe credits to the fold, not the deposit
+cat > "$WORK/hot_journal.txt" <<EOF
+open savings 600 1111 Hot Saver
+hot 100 on
+deposit 100 1000 1111
+EOF
+OUTPUT=$(cd "$WORK" && {
+    printf '22\nhot_journal.txt\nn\n'
+    sleep 1
+    BEFORE_FOLD=$(date '+%Y-%m-%d %H:%M:%S')
+    sleep 1
+    printf '2\n100\n'
+    sleep 1
+    AFTER_FOLD=$(date '+%Y-%m-%d %H:%M:%S')
+    printf '19\n1\n100\n%s\n19\n1\n100\n%s\n0\n' "$BEFORE_FOLD" "$AFTER_FOLD"
+} | "$BANK" 2>&1 | grep -o "Balance of account.*")
+check "as-of query between deposit and fold leaves stripe credits out" ": \$600.00" "$(printf '%s\n' "$OUTPUT" | sed -n 1p)"
+check "as-of query after the fold includes stripe credits" ": \$1600.00" "$(printf '%s\n' "$OUTPUT" | sed -n 2p)"
+
+# A capture that fires a standing order, opens and closes accounts and toggles a hot account
+# replays to the same book
+cat > "$WORK/capture.txt" <<EOF
+open current 2000 1111 Payer One
+open current 510 2222 Payee Two
+schedule 100 101 50 1111 0 0
+capture-start traffic.trace
+run-due
+open current 10 3333 New Three
+deposit 102 500 3333
+hot 101 on
+deposit 101 25 2222
+transfer 102 101 5 3333
+hot 101 off
+close 102
+interest
+capture-stop
+EOF
+check "capture batch runs" "14 command(s), 14 succeeded" "$(cd "$WORK" && "$BANK" --batch capture.txt 2>&1)"
+OUTPUT=$(cd "$WORK" && "$BANK" --replay traffic.trace 2>&1)
+check "replay has no outcome divergences" "Outcome divergences: 0" "$OUTPUT"
+check "replay matches the captured book" "Final book: matches the captured book" "$OUTPUT"
+
+# A velocity rule's window is enforced at its configured length, not rounded up to a minute
+cat > "$WORK/velocity_open.txt" <<EOF
+open current 1000 1111 Quick Spender
+EOF
+cat > "$WORK/velocity_debit.txt" <<EOF
+withdraw 100 1 1111
+EOF
+OUTPUT=$(cd "$WORK" && {
+    printf '22\nvelocity_open.txt\nn\n16\n2\n100\n1\n0\n2\n22\nvelocity_debit.txt\nn\n22\nvelocity_debit.txt\nn\n'
+    sleep 3
+    printf '22\nvelocity_debit.txt\nn\n0\n'
+} | "$BANK" 2>&1 | grep -o "Batch velocity_debit.txt.*")
+check "second debit inside a 2-second window is rejected" "0 succeeded, 1 rejected" "$(printf '%s\n' "$OUTPUT" | sed -n 2p)"
+check "debit after the 2-second window has passed is allowed" "1 succeeded, 0 rejected" "$(printf '%s\n' "$OUTPUT" | sed -n 3p)"
+
+# Amounts past the cap are malformed, and credits that would take a balance past it are refused
+cat > "$WORK/overflow.txt" <<EOF
+open current 10 1111 Big Spender
+deposit 100 90000000000000000 1111
+deposit 100 6000000000 1111
+deposit 100 6000000000 1111
+EOF
+check "oversized amounts and balances are turned away" \
+    "4 command(s), 2 succeeded, 1 rejected, 1 malformed" \
+    "$(cd "$WORK" && "$BANK" --batch overflow.txt 2>&1)"
+
+exit $FAILED